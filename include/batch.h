@@ -0,0 +1,103 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lane counts are padded to this so vector loops never need a tail.
+#define CHIP8_BATCH_LANE_ALIGN 32
+
+// Many machines running the same rom in lockstep. The registers the ALU
+// touches live in lane-contiguous arrays; everything else (memory, screen,
+// keys, rng) stays in one Chip8 per lane.
+//
+// On CPUs with AVX2 each step picks the lowest PC among lanes still running
+// this frame and executes that instruction for every lane sitting on it.
+// Groups that only touch registers, timers, the stack and keys (8XYN, 6XNN,
+// 7XNN, skips, 1NNN, 2NNN, 00EE, ANNN, FX07/15/18/1E/29) run lane-parallel.
+// Anything else goes lane by lane through chip8_execute() on that lane's
+// Chip8, which keeps running until it reaches a lane-parallel instruction.
+// Without AVX2 each lane just runs through chip8_execute() in turn. With it
+// the batch counts how often lanes fall back to chip8_execute() and drops
+// to that plain loop for a while when they do so often, since roms whose
+// lanes rarely share a PC run slower through the kernels. The choice comes
+// from those counts alone, never from time, so every run is reproducible.
+typedef struct {
+  int lanes;
+  int stride;  // lanes rounded up to CHIP8_BATCH_LANE_ALIGN
+
+  uint8_t* V[REG_SIZE];  // V[r][lane]
+  uint16_t* PC;
+  uint16_t* I;
+  uint8_t* delay_timer;
+  uint8_t* sound_timer;
+  uint8_t* SP;
+  uint16_t* stack[STACK_SIZE];  // stack[depth][lane]
+
+  // scheduler scratch, valid during chip8_batch_run_frame()
+  uint16_t* retired;  // instructions retired this frame
+  uint16_t* next_pc;  // PC of lanes still running, 0xFFFF once done
+  uint8_t* group;     // 0xFF for lanes in the group being executed
+  uint8_t* keys_lo;   // keys 0-7 of each lane as bits, taken at frame start
+  uint8_t* keys_hi;   // keys 8-F
+
+  Chip8* machines;
+  Chip8* initial;  // the state every lane starts from
+
+  // initial->code, shared by all lanes. Entries near a memory write by any
+  // lane are set to OP_NONE and run lane by lane from then on.
+  Chip8Insn code[MEM_SIZE];
+
+  // The AVX2 kernels may be used; set by chip8_batch_init() from the CPU.
+  // Clear it to force the plain path.
+  bool kernels;
+  // The kernels run right now, so V, PC, I, timers and the stack live in
+  // the lane arrays rather than in machines.
+  bool vector;
+  // Path choice, kept by chip8_batch_run_frame().
+  int frames_left;         // until the path is chosen again
+  int stay_frames;         // on the plain path after the kernels lose
+  uint64_t window_runs;    // lane_runs at the start of the window
+  uint64_t window_vector;  // vector_insns at the start of the window
+  uint64_t window_scalar;  // scalar_insns at the start of the window
+
+  // Lanes whose Chip8 has a fault, counted while the kernels run. Faulted
+  // lanes stop like a machine would, see chip8_execute().
+  int faulted;
+
+  uint64_t vector_insns;  // lane-instructions retired lane-parallel
+  uint64_t scalar_insns;  // lane-instructions retired by chip8_execute()
+  uint64_t lane_runs;     // times a lane left the kernels for chip8_execute()
+} Chip8Batch;
+
+// Loads romPath into lanes machines. seeds[lane] seeds CXNN; NULL seeds
+// lane i with i + 1 so runs are reproducible. Returns false (with a message
+// on stderr) if the rom can't be loaded or the lanes allocated.
+bool chip8_batch_init(Chip8Batch* batch, int lanes, const char* romPath, const uint32_t* seeds);
+
+// Runs every lane for insns_per_frame instructions, then ticks the timers,
+// the same as calling chip8_execute() and chip8_tick() on each lane. A
+// lane that faults stops, with machines[lane].fault saying why.
+void chip8_batch_run_frame(Chip8Batch* batch, int insns_per_frame);
+
+// Puts the lane back in its starting state, reseeding CXNN with seed.
+void chip8_batch_reset_lane(Chip8Batch* batch, int lane, uint32_t seed);
+
+// The lane's Chip8 with its registers brought up to date. Keys may be set
+// on it directly; register writes are lost on the next frame.
+Chip8* chip8_batch_lane(Chip8Batch* batch, int lane);
+
+void chip8_batch_free(Chip8Batch* batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __BATCH_H__
@@ -0,0 +1,42 @@
+#ifndef __CFG_H__
+#define __CFG_H__
+
+#include <stdint.h>
+
+#include "chip8.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-byte flags filled in by chip8_cfg_analyze().
+#define CFG_CODE 0x01      // byte belongs to a reachable instruction
+#define CFG_INSN 0x02      // a reachable instruction starts here
+#define CFG_LEADER 0x04    // a basic block starts here
+#define CFG_ENTRY 0x08     // subroutine entry (program start or 2NNN target)
+#define CFG_SPRITE 0x10    // ANNN target that is never reached as code
+#define CFG_INDIRECT 0x20  // BNNN, successors are not known statically
+
+typedef struct {
+  uint8_t flags[MEM_SIZE];
+  uint16_t start;  // program entry, normally 0x200
+  uint16_t end;    // one past the last ROM byte
+} Chip8Cfg;
+
+// Recursive-descent analysis of memory[start, end) from start, following
+// 1NNN/2NNN and both arms of every skip. Bytes not reached stay flagged 0
+// and are treated as data.
+void chip8_cfg_analyze(const uint8_t* memory, uint16_t start, uint16_t end, Chip8Cfg* cfg);
+
+// Address of the last instruction of the basic block that starts at leader.
+uint16_t chip8_cfg_block_last(const Chip8Cfg* cfg, const uint8_t* memory, uint16_t leader);
+
+// Intraprocedural successors of the instruction at addr (2NNN falls through
+// to the return address). Returns how many were written to succ.
+int chip8_cfg_successors(const Chip8Cfg* cfg, const uint8_t* memory, uint16_t addr, uint16_t succ[2]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __CFG_H__
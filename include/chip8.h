@@ -3,6 +3,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define MEM_SIZE 4096
 #define SCREEN_H 32
 #define SCREEN_W 64
@@ -12,20 +18,80 @@
 #define KEY_SIZE 16
 #define MAX_ROM_SIZE (0x1000 - 0x200)
 #define SCREEN_IDX(row, col) ((row)*SCREEN_W + (col))
+#define FONTSET_ADDRESS 0x50
+#define FONTSET_BYTES_PER_CHAR 5
+
+// Why a machine stopped. A faulted machine executes nothing more until it
+// is reinitialized; the host decides what to do about it.
+typedef enum {
+  CHIP8_FAULT_NONE,
+  CHIP8_FAULT_PC,               // PC ran off the end of memory
+  CHIP8_FAULT_I,                // I, or a load/store through it, outside memory
+  CHIP8_FAULT_STACK_UNDERFLOW,  // 00EE with an empty stack
+  CHIP8_FAULT_STACK_OVERFLOW,   // 2NNN with a full stack
+} Chip8Fault;
+
+// One CHIP-8 machine. Any number of these can run side by side.
+typedef struct {
+  uint8_t memory[MEM_SIZE];  // 4kB RAM
+  // 16 (8bit) registers 0-F called V0-VF
+  // VF can be used as a carry flag or can be set to 1 or 0 based on some rule.
+  uint8_t V[REG_SIZE];
+  uint16_t I;   // used to point at locations in memory
+  uint16_t PC;  // points at the current instruction in memory
+  uint16_t stack[STACK_SIZE];
+  uint8_t SP;  // stack_pointer
+  uint8_t delay_timer;
+  uint8_t sound_timer;
+  uint8_t screen[SCREEN_SIZE];
+  bool keys[KEY_SIZE];
+  bool draw_flag;
+  uint32_t rng;  // xorshift state for CXNN
+  Chip8Fault fault;
 
-void chip8_init(); //initializes chip8 vars
-uint16_t chip8_fetch();
-void chip8_execute();
-void chip8_load_rom(char *romPath); // loads rom from the given filepath
-void chip8_set_draw_false();
-void chip8_tick();
-void chip8_draw();
-void chip8_key_down(uint8_t key);
-void chip8_key_up(uint8_t key);
+  // COSMAC VIP timing model, see chip8_run_frame_vip()
+  int32_t vip_cycles;        // cycles charged since the frame started
+  uint16_t vip_draw_cycles;  // cost of the most recent DXYN
+  bool vip_vblank_wait;      // a DXYN is waiting for the next vblank
+
+  // Decoded instruction for every address of the loaded rom image, built
+  // by chip8_load_rom() and only read afterwards, so copies of a machine
+  // share it. NULL, with every address dirty, until a rom is loaded.
+  const Chip8Insn* code;
+  // Addresses whose code entry is stale because memory was written near
+  // them, one bit each; those are decoded from memory on every fetch.
+  uint8_t dirty[MEM_SIZE / 8];
+} Chip8;
+
+void chip8_init(Chip8* chip); //initializes chip8 vars
+void chip8_seed(Chip8* chip, uint32_t seed); // makes CXNN reproducible
+uint16_t chip8_fetch(Chip8* chip);
+// Returns the number of instructions retired. On a guest error it sets
+// chip->fault instead; a faulted machine does nothing and returns 1, so
+// loops running a fixed number of instructions still end.
+int chip8_execute(Chip8* chip);
+// False if the file can't be read or the decode table allocated. The table
+// is shared by copies of chip; free it once with chip8_free().
+bool chip8_load_rom(Chip8* chip, const char* romPath);
+void chip8_free(Chip8* chip);
+const char* chip8_fault_name(Chip8Fault fault);
+void chip8_set_draw_false(Chip8* chip);
+void chip8_tick(Chip8* chip);
+// Runs one 60 Hz frame under the COSMAC VIP timing model: opcodes are charged
+// VIP machine cycles, DXYN waits for vblank, then the timers tick once.
+// Returns the number of instructions retired.
+int chip8_run_frame_vip(Chip8* chip);
+void chip8_key_down(Chip8* chip, uint8_t key);
+void chip8_key_up(Chip8* chip, uint8_t key);
+bool chip8_sound_on(const Chip8* chip); // true while the sound timer runs
 
 
 typedef uint8_t ScreenRow[SCREEN_W];
-const uint8_t* chip8_get_screen();
-bool chip8_can_draw();
+const uint8_t* chip8_get_screen(const Chip8* chip);
+bool chip8_can_draw(const Chip8* chip);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif // __CHIP_8_H__
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef __DECODE_H__
+#define __DECODE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Instruction kinds produced by the decoder. OP_NONE marks an empty slot in
+// the decode cache, OP_UNKNOWN an opcode the interpreter treats as a no-op.
+typedef enum {
+  OP_NONE = 0,
+  OP_UNKNOWN,
+  OP_SYS,       // 0NNN
+  OP_CLS,       // 00E0
+  OP_RET,       // 00EE
+  OP_JP,        // 1NNN
+  OP_CALL,      // 2NNN
+  OP_SE_IMM,    // 3XNN
+  OP_SNE_IMM,   // 4XNN
+  OP_SE_REG,    // 5XY0
+  OP_LD_IMM,    // 6XNN
+  OP_ADD_IMM,   // 7XNN
+  OP_LD_REG,    // 8XY0
+  OP_OR,        // 8XY1
+  OP_AND,       // 8XY2
+  OP_XOR,       // 8XY3
+  OP_ADD_REG,   // 8XY4
+  OP_SUB,       // 8XY5
+  OP_SHR,       // 8XY6
+  OP_SUBN,      // 8XY7
+  OP_SHL,       // 8XYE
+  OP_SNE_REG,   // 9XY0
+  OP_LD_I,      // ANNN
+  OP_JP_V,      // BNNN
+  OP_RND,       // CXNN
+  OP_DRW,       // DXYN
+  OP_SKP,       // EX9E
+  OP_SKNP,      // EXA1
+  OP_LD_VX_DT,  // FX07
+  OP_LD_VX_K,   // FX0A
+  OP_LD_DT,     // FX15
+  OP_LD_ST,     // FX18
+  OP_ADD_I,     // FX1E
+  OP_LD_F,      // FX29
+  OP_LD_B,      // FX33
+  OP_LD_MEM,    // FX55
+  OP_LD_REGS,   // FX65
+  OP_COUNT
+} Chip8Op;
+
+// Superinstructions: an instruction plus the one or two after it, run by a
+// single handler. Picked from chip8-dis -n counts over the bundled roms.
+typedef enum {
+  FUSE_NONE = 0,
+  FUSE_ADD_SKIP,      // 7XNN 3XNN/4XNN       loop counter
+  FUSE_ADDI_LOAD,     // FX1E FX65            table lookup
+  FUSE_SPRITE_SETUP,  // 6XNN 6YNN DXYN       position and draw
+  FUSE_DELAY_WAIT,    // FX07 3X00 1NNN       spin on the delay timer
+  FUSE_COUNT
+} Chip8Fuse;
+
+// A pre-split instruction, so the hot loop never has to mask nibbles.
+typedef struct {
+  uint16_t opcode;
+  uint16_t nnn;
+  uint8_t op;    // Chip8Op
+  uint8_t fuse;  // Chip8Fuse, only set by the interpreter's decode cache
+  uint8_t x;
+  uint8_t y;
+  uint8_t n;
+  uint8_t nn;
+} Chip8Insn;
+
+Chip8Insn chip8_decode(uint16_t opcode);
+
+// Returns the Chip8Fuse for a (at addr) followed by b and c.
+uint8_t chip8_fuse(const Chip8Insn* a, const Chip8Insn* b, const Chip8Insn* c, uint16_t addr);
+
+// true for 1NNN/BNNN/00EE, after which execution never falls through.
+bool chip8_insn_is_terminator(const Chip8Insn* insn);
+
+// true for the 3XNN/4XNN/5XY0/9XY0/EX9E/EXA1 family.
+bool chip8_insn_is_skip(const Chip8Insn* insn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __DECODE_H__
@@ -0,0 +1,16 @@
+#ifndef __DISASM_H__
+#define __DISASM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "decode.h"
+
+// Writes the mnemonic for insn (e.g. "LD V3, 0x1F") into buf.
+// Returns the number of characters snprintf would have written.
+int chip8_disasm(const Chip8Insn* insn, char* buf, size_t len);
+
+// Opcode pattern for a Chip8Op, e.g. "7XNN" for OP_ADD_IMM.
+const char* chip8_op_pattern(uint8_t op);
+
+#endif  // __DISASM_H__
@@ -6,16 +6,19 @@
 
 #include "chip8.h"
 
-// Initialize SDL window and renderer/OpenGL context.
-void display_init();
+// Initialize SDL window and renderer/OpenGL context with a streaming
+// texture of width x height CHIP-8 pixels (SCREEN_W x SCREEN_H for one
+// machine, larger for the wall).
+void display_init(int width, int height);
 
-// Render the CHIP-8 framebuffer (screen[32][64]) to the window.
-// This function should take the buffer as input eventually.
-void display_render(const uint8_t* screen);
+// Convert a width x height frame of FRAME_* bytes to ARGB8888, upload it
+// with a single SDL_UpdateTexture and present it.
+void display_present(const uint8_t* frame);
 
-// Poll SDL events (keyboard + quit).
+// Poll SDL events (keyboard + quit). Keyboard state goes to chip, which
+// may be NULL when no machine takes input.
 // Should return true when user requests quit.
-bool display_poll_events();
+bool display_poll_events(Chip8* chip);
 
 // Destroy window and quit SDL.
 void display_cleanup();
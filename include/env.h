@@ -0,0 +1,129 @@
+#ifndef __ENV_H__
+#define __ENV_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "batch.h"
+#include "chip8.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Many environments running one rom, for driving the emulator from a
+// training loop. Built on Chip8Batch; library target libchip8.
+//
+// Observations, rewards and done flags of every environment live in one
+// block, on the heap or in a POSIX shared memory segment another process
+// can map. chip8_env_step() writes them in place and only repacks screens
+// that were drawn to, so a step costs no syscall or copy per environment.
+//
+// Block layout (native endian), each array aligned to CHIP8_ENV_ALIGN:
+//   Chip8EnvHeader
+//   obs     uint8_t[envs][CHIP8_ENV_OBS_BYTES]  1bpp rows, MSB first
+//   reward  float[envs]
+//   done    uint8_t[envs]
+#define CHIP8_ENV_MAGIC "C8EV"
+#define CHIP8_ENV_VERSION 2
+#define CHIP8_ENV_ALIGN 64
+#define CHIP8_ENV_OBS_BYTES (SCREEN_SIZE / 8)
+#define CHIP8_ENV_NO_KEY 16          // action that holds no key
+#define CHIP8_ENV_INSNS_PER_FRAME 20  // 1200 Hz at 60 frames per second
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t envs;
+  uint32_t obs_bytes;  // per environment
+  uint64_t obs_offset;  // from the start of the block
+  uint64_t reward_offset;
+  uint64_t done_offset;
+  uint64_t size;
+  // Seqlock over the outputs: odd while a reset or step writes them, even
+  // once it is done, so steps / 2 counts the published ones. The writer
+  // stores it with release ordering; readers load it with acquire ordering
+  // (e.g. __atomic_load_n) and retry a copy that raced a write:
+  //
+  //   uint64_t before, after;
+  //   do {
+  //     before = __atomic_load_n(&header->steps, __ATOMIC_ACQUIRE);
+  //     ... copy the obs, reward and done entries needed ...
+  //     __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  //     after = __atomic_load_n(&header->steps, __ATOMIC_RELAXED);
+  //   } while ((before & 1) != 0 || before != after);
+  uint64_t steps;
+} Chip8EnvHeader;
+
+// What the reward of a step measures: the change in a memory byte or
+// V register across the step (e.g. where the rom keeps its score).
+typedef enum {
+  CHIP8_REWARD_NONE,
+  CHIP8_REWARD_MEMORY,
+  CHIP8_REWARD_REGISTER,
+} Chip8RewardSource;
+
+typedef struct {
+  Chip8Batch batch;
+  int envs;
+  int insns_per_frame;
+
+  Chip8RewardSource reward_source;
+  int reward_index;
+  uint8_t* reward_last;  // reward byte of each env after the last step
+
+  // views into the output block
+  Chip8EnvHeader* header;
+  uint8_t* obs;
+  float* reward;
+  uint8_t* done;
+
+  char* shm_name;  // NULL when the block is on the heap
+} Chip8Env;
+
+// Loads romPath into envs environments. With shmName (e.g. "/chip8-env")
+// the output block is created as that shared memory segment, replacing
+// any stale one; otherwise, and always on Windows, it is allocated
+// privately. Call chip8_env_reset() before the first step. Returns false
+// (with a message on stderr) if the rom, memory or segment can't be had,
+// leaving nothing to free.
+bool chip8_env_init(Chip8Env* env, int envs, const char* romPath, const char* shmName);
+
+// Applies to rewards from the next step on. index is an address for
+// CHIP8_REWARD_MEMORY and a register for CHIP8_REWARD_REGISTER; false if
+// it is out of range.
+bool chip8_env_set_reward(Chip8Env* env, Chip8RewardSource source, int index);
+
+// Restarts every environment; seeds[env] seeds CXNN, NULL seeds env i with
+// i + 1. Writes fresh observations, zero rewards and clears done. False if
+// env was never initialized.
+bool chip8_env_reset(Chip8Env* env, const uint32_t* seeds);
+
+// Restarts one environment, e.g. after it reported done; false if there is
+// no such environment.
+bool chip8_env_reset_one(Chip8Env* env, int index, uint32_t seed);
+
+// Holds actions[env] (a key 0-F or CHIP8_ENV_NO_KEY) for frames frames of
+// env->insns_per_frame instructions each, then writes the outputs. An
+// environment is done once it jumps to itself, which it can never leave,
+// or its machine faults (env->batch.machines[env].fault says why); it keeps
+// reporting done until reset.
+void chip8_env_step(Chip8Env* env, const uint8_t* actions, int frames);
+
+// Unmaps and removes the shared memory segment, if any.
+void chip8_env_free(Chip8Env* env);
+
+// Consumer side: maps an existing segment read-only. Returns NULL (with a
+// message on stderr) if it is missing or not an environment block.
+const Chip8EnvHeader* chip8_env_attach(const char* shmName);
+void chip8_env_detach(const Chip8EnvHeader* header);
+
+static inline const uint8_t* chip8_env_obs_of(const Chip8EnvHeader* header, int index) {
+  return (const uint8_t*)header + header->obs_offset + (uint64_t)index * header->obs_bytes;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __ENV_H__
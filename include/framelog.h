@@ -0,0 +1,80 @@
+#ifndef __FRAMELOG_H__
+#define __FRAMELOG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame log file format (little endian):
+//   header: "C8FL", u8 version, u16 width, u16 height
+//   record: u8 type, u64 timestamp (usec), u32 length, payload
+// Frames are 1bpp, MSB first. Every payload is the frame XORed with a
+// reference and run-length encoded as (zero run, literal count, literals)
+// triplets. Keyframes use an all-zero reference, deltas the previous frame.
+#define FRAMELOG_MAGIC "C8FL"
+#define FRAMELOG_VERSION 1
+#define FRAMELOG_KEYFRAME 0
+#define FRAMELOG_DELTA 1
+// A keyframe every second or so at 60 fps keeps seeks short.
+#define FRAMELOG_KEYFRAME_INTERVAL 60
+
+static inline size_t framelog_frame_bytes(int width, int height) {
+  return ((size_t)width * height + 7) / 8;
+}
+
+// Upper bound for framelog_encode() output on n input bytes.
+static inline size_t framelog_max_encoded(size_t n) {
+  return 3 * n + 2;
+}
+
+// Packs width*height FRAME_* bytes to 1bpp; only FRAME_ON becomes a 1.
+void framelog_pack(const uint8_t* frame, size_t pixels, uint8_t* bits);
+void framelog_unpack(const uint8_t* bits, size_t pixels, uint8_t* frame);
+
+// Encodes cur XOR prev (prev NULL for a keyframe) into out.
+// Returns the number of bytes written.
+size_t framelog_encode(const uint8_t* cur, const uint8_t* prev, size_t n, uint8_t* out);
+
+// XORs an encoded payload into bits (the reference frame). false if malformed.
+bool framelog_decode(const uint8_t* in, size_t len, uint8_t* bits, size_t n);
+
+bool framelog_write_header(FILE* f, uint16_t width, uint16_t height);
+bool framelog_write_record(FILE* f, uint8_t type, uint64_t usec, const uint8_t* payload, uint32_t len);
+
+// Random access over a finished or still growing log.
+typedef struct {
+  FILE* file;
+  uint16_t width;
+  uint16_t height;
+  size_t frame_bytes;
+  size_t count;          // number of frames
+  long* offsets;         // file offset of each record
+  uint64_t* timestamps;  // usec of each frame
+  uint8_t* types;        // FRAMELOG_KEYFRAME or FRAMELOG_DELTA
+  uint8_t* bits;         // decoded frame at position
+  uint8_t* payload;      // scratch for one record
+  size_t position;       // index decoded into bits, count if none
+} FramelogReader;
+
+// Opens path and indexes every complete record.
+bool framelog_open(FramelogReader* reader, const char* path);
+
+// Decodes frame index into reader->bits, starting from the closest
+// keyframe unless the reader is already on the way there.
+bool framelog_seek(FramelogReader* reader, size_t index);
+
+// Index of the last frame with a timestamp <= usec (0 if none is).
+size_t framelog_find(const FramelogReader* reader, uint64_t usec);
+
+void framelog_close(FramelogReader* reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __FRAMELOG_H__
@@ -0,0 +1,36 @@
+#ifndef __FRONTEND_H__
+#define __FRONTEND_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+// Pixel values in the frames handed to Frontend.present.
+#define FRAME_OFF 0
+#define FRAME_ON 1
+#define FRAME_BORDER 2  // gutter between wall tiles
+
+// Everything the main loop needs from an output/input backend.
+typedef struct {
+  const char* name;
+  // Open the output for frames of width x height CHIP-8 pixels.
+  void (*init)(int width, int height);
+  // Show one frame, width x height bytes of FRAME_* values.
+  void (*present)(const uint8_t* frame);
+  // Feed key state into chip (NULL when no machine takes input).
+  // Returns true when the user asked to quit.
+  bool (*poll)(Chip8* chip);
+  // Start or stop the buzzer.
+  void (*beep)(bool on);
+  void (*cleanup)();
+} Frontend;
+
+extern const Frontend frontend_sdl;
+extern const Frontend frontend_null;
+extern const Frontend frontend_term;
+
+// Looks a frontend up by name ("sdl", "null", "term"); NULL if unknown.
+const Frontend* frontend_find(const char* name);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Streams presented frames to a frame log (see framelog.h). Capture only
+// packs the frame into a lock-free queue; a writer thread delta encodes and
+// writes it, so recording never stalls emulation on disk I/O. Returns false
+// (with a message on stderr) if the file can't be opened or written, or the
+// writer can't be started.
+bool recorder_start(const char* path, int width, int height);
+
+// Queues a width x height frame of FRAME_* bytes shown at usec. Never
+// blocks: if the writer has fallen a whole queue behind the frame is dropped.
+// Does nothing once a write has failed.
+void recorder_capture(const uint8_t* frame, uint64_t usec);
+
+// Writes out everything still queued and closes the file, reporting on
+// stderr if any write failed.
+void recorder_stop();
+
+#endif  // __RECORDER_H__
@@ -0,0 +1,28 @@
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#include <stdint.h>
+
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// COSMAC VIP: 1.7609 MHz CDP1802, 8 clocks per machine cycle, 60 Hz frames.
+#define VIP_CYCLES_PER_FRAME 3668
+// Cycles stolen every frame by the CDP1861 display DMA and the interrupt
+// routine, so never available to the interpreter.
+#define VIP_FRAME_OVERHEAD 1100
+#define VIP_INTERPRETER_CYCLES (VIP_CYCLES_PER_FRAME - VIP_FRAME_OVERHEAD)
+
+// Approximate machine cycles the VIP interpreter spends on insn, including
+// fetch and decode. vx is the value of V[insn->x], which decides the sprite
+// alignment cost of DXYN.
+uint16_t chip8_vip_cycles(const Chip8Insn* insn, uint8_t vx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __TIMING_H__
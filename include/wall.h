@@ -0,0 +1,25 @@
+#ifndef __WALL_H__
+#define __WALL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Loads every rom into its own machine and tiles them in a grid that is
+// presented as one atlas frame. threads > 1 spreads the machines over that
+// many threads, the caller's included.
+void wall_init(char** roms, int count, int threads, int insns_per_frame, bool vip_timing);
+
+// Runs one 60 Hz frame on every machine and blits the ones that drew.
+void wall_run_frame();
+
+// Size of the atlas frame in CHIP-8 pixels, gutters included.
+void wall_size(int* width, int* height);
+
+// The atlas (FRAME_* bytes) if any machine drew since the last call,
+// otherwise NULL.
+const uint8_t* wall_take_frame();
+
+// Stops the worker threads and frees the machines.
+void wall_cleanup();
+
+#endif
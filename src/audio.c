@@ -22,6 +22,11 @@ static void audio_callback(void* userdata, uint8_t* stream, int len) {
 void audio_init() {
   SDL_AudioSpec want, have;
 
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+    fprintf(stderr, "Audio error: %s\n", SDL_GetError());
+    exit(1);
+  }
+
   SDL_zero(want);
   want.freq = SAMPLE_RATE;
   want.format = AUDIO_U8;
@@ -0,0 +1,749 @@
+#include "batch.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The lane-parallel kernels are built for AVX2 whatever the target flags,
+// and only run when the CPU has it (see chip8_batch_init()).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BATCH_KERNELS 1
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+#define PC_DONE 0xFFFF
+// Set in next_pc for a lane whose I is outside memory: its next instruction
+// must go through chip8_execute(), which faults there. Such lanes sort after
+// every real PC and never run lane-parallel.
+#define PC_STRAY 0x8000
+#define MAX_BUDGET 0xFFF0  // retired counts are 16 bit
+
+// Path choice, from counters so a run depends only on the rom and its input:
+// the kernels stay while each PROBE_FRAMES window sees less than one
+// chip8_execute() fallback per lane and frame and retires at least
+// MIN_VECTOR_PERCENT of its instructions lane-parallel. Otherwise the lanes
+// run one after another for STAY_FRAMES before the kernels are tried again;
+// each failed try doubles that, up to MAX_STAY_FRAMES.
+#define PROBE_FRAMES 30
+#define MIN_VECTOR_PERCENT 80
+#define STAY_FRAMES 600
+#define MAX_STAY_FRAMES 19200
+
+// Stops a lane while the kernels run; it keeps its PC on the faulting
+// instruction and leaves the frame like a lane that used up its budget.
+static void fault_lane(Chip8Batch* batch, int lane, Chip8Fault fault) {
+  batch->machines[lane].fault = fault;
+  batch->next_pc[lane] = PC_DONE;
+  batch->faulted++;
+}
+
+static void invalidate_shared(Chip8Batch* batch, uint16_t addr, unsigned len) {
+  // a fused entry up to 5 bytes earlier may cover addr
+  unsigned from = addr > 5 ? addr - 5u : 0u;
+  unsigned to = addr + len;
+  if (to > MEM_SIZE) to = MEM_SIZE;
+  for (unsigned a = from; a < to; a++) {
+    batch->code[a].op = OP_NONE;
+  }
+}
+
+static void gather(Chip8Batch* batch, int lane) {
+  Chip8* chip = &batch->machines[lane];
+  for (int r = 0; r < REG_SIZE; r++) {
+    chip->V[r] = batch->V[r][lane];
+  }
+  chip->PC = batch->PC[lane];
+  chip->I = batch->I[lane];
+  chip->delay_timer = batch->delay_timer[lane];
+  chip->sound_timer = batch->sound_timer[lane];
+  chip->SP = batch->SP[lane];
+  for (int d = 0; d < chip->SP && d < STACK_SIZE; d++) {
+    chip->stack[d] = batch->stack[d][lane];
+  }
+}
+
+static void scatter(Chip8Batch* batch, int lane) {
+  const Chip8* chip = &batch->machines[lane];
+  for (int r = 0; r < REG_SIZE; r++) {
+    batch->V[r][lane] = chip->V[r];
+  }
+  batch->PC[lane] = chip->PC;
+  batch->I[lane] = chip->I;
+  batch->delay_timer[lane] = chip->delay_timer;
+  batch->sound_timer[lane] = chip->sound_timer;
+  batch->SP[lane] = chip->SP;
+  for (int d = 0; d < chip->SP && d < STACK_SIZE; d++) {
+    batch->stack[d][lane] = chip->stack[d];
+  }
+}
+
+static bool runs_lane_parallel(const Chip8Insn* insn) {
+  if (insn->fuse == FUSE_ADD_SKIP || insn->fuse == FUSE_DELAY_WAIT) return true;
+  if (insn->fuse != FUSE_NONE) return false;
+
+  switch (insn->op) {
+    case OP_JP:
+    case OP_CALL:
+    case OP_RET:
+    case OP_SE_IMM:
+    case OP_SNE_IMM:
+    case OP_SE_REG:
+    case OP_LD_IMM:
+    case OP_ADD_IMM:
+    case OP_LD_REG:
+    case OP_OR:
+    case OP_AND:
+    case OP_XOR:
+    case OP_ADD_REG:
+    case OP_SUB:
+    case OP_SHR:
+    case OP_SUBN:
+    case OP_SHL:
+    case OP_SNE_REG:
+    case OP_LD_I:
+    case OP_SKP:
+    case OP_SKNP:
+    case OP_LD_VX_DT:
+    case OP_LD_DT:
+    case OP_LD_ST:
+    case OP_ADD_I:
+    case OP_LD_F:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// EX9E/EXA1 test one bit of these instead of the lanes' Chip8 keys.
+static void snapshot_keys(Chip8Batch* batch) {
+  for (int l = 0; l < batch->lanes; l++) {
+    const bool* keys = batch->machines[l].keys;
+    uint8_t lo = 0;
+    uint8_t hi = 0;
+    for (int k = 0; k < 8; k++) {
+      lo |= keys[k] << k;
+      hi |= keys[k + 8] << k;
+    }
+    batch->keys_lo[l] = lo;
+    batch->keys_hi[l] = hi;
+  }
+}
+
+// Runs the lane on its own Chip8 through chip8_execute() until it reaches
+// an instruction that can run lane-parallel again or has retired budget
+// instructions, so one gather/scatter covers a whole run of them.
+static int run_lane(Chip8Batch* batch, int lane, int budget) {
+  Chip8* chip = &batch->machines[lane];
+  int retired = 0;
+  gather(batch, lane);
+
+  do {
+    // FX33 and FX55 are the only memory writes. After one, the shared
+    // decode of the written bytes no longer speaks for every lane.
+    uint16_t write_at = chip->I;
+    unsigned write_len = 0;
+    if (chip->PC < MEM_SIZE - 1 && (chip->memory[chip->PC] & 0xF0) == 0xF0) {
+      uint8_t low = chip->memory[chip->PC + 1];
+      if (low == 0x33) {
+        write_len = 3;
+      } else if (low == 0x55) {
+        write_len = (chip->memory[chip->PC] & 0x0F) + 1u;
+      }
+    }
+
+    retired += chip8_execute(chip);
+    if (write_len > 0) invalidate_shared(batch, write_at, write_len);
+  } while (retired < budget && chip->fault == CHIP8_FAULT_NONE &&
+           (chip->I >= MEM_SIZE || !(chip->PC < MEM_SIZE - 2 && runs_lane_parallel(&batch->code[chip->PC]))));
+
+  scatter(batch, lane);
+  return retired;
+}
+
+#ifdef BATCH_KERNELS
+
+static inline AVX2 __m256i load(const void* p) {
+  return _mm256_loadu_si256((const __m256i*)p);
+}
+
+static inline AVX2 void store(void* p, __m256i v) {
+  _mm256_storeu_si256((__m256i*)p, v);
+}
+
+static AVX2 uint16_t lowest_pc(const Chip8Batch* batch) {
+  __m256i lowest = _mm256_set1_epi16(-1);
+  for (int l = 0; l < batch->stride; l += 16) {
+    lowest = _mm256_min_epu16(lowest, load(&batch->next_pc[l]));
+  }
+  __m128i half = _mm_min_epu16(_mm256_castsi256_si128(lowest), _mm256_extracti128_si256(lowest, 1));
+  return (uint16_t)_mm_cvtsi128_si32(_mm_minpos_epu16(half));
+}
+
+static AVX2 void select_group(Chip8Batch* batch, uint16_t pc) {
+  __m256i target = _mm256_set1_epi16((short)pc);
+  for (int l = 0; l < batch->stride; l += 32) {
+    __m256i lo = _mm256_cmpeq_epi16(load(&batch->next_pc[l]), target);
+    __m256i hi = _mm256_cmpeq_epi16(load(&batch->next_pc[l + 16]), target);
+    // packs works per 128-bit half; put the lanes back in order
+    store(&batch->group[l], _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8));
+  }
+}
+
+enum { I_KEEP, I_LOAD, I_ADD, I_FONT };
+
+// How the group's instruction moves PC and I and counts against the budget.
+typedef struct {
+  bool jump;             // PC = target instead of PC + length
+  uint16_t target;
+  uint16_t length;       // bytes PC moves by
+  uint16_t skip_length;  // extra bytes on lanes whose skip byte is set
+  uint16_t retire;       // instructions retired
+  uint16_t skip_retire;  // extra instructions on skipping lanes, may wrap
+  uint8_t i_op;
+  uint16_t budget;
+} GroupStep;
+
+// Applies step to 16 lanes; group8, skip8 and vx8 hold one byte per lane.
+static inline AVX2 void advance16(Chip8Batch* batch, int l, __m128i group8, __m128i skip8, __m128i vx8,
+                             const GroupStep* step) {
+  __m256i group = _mm256_cvtepi8_epi16(group8);
+  __m256i skip = _mm256_cvtepi8_epi16(skip8);
+
+  __m256i pc = load(&batch->PC[l]);
+  __m256i stray = _mm256_setzero_si256();
+  __m256i next;
+  if (step->jump) {
+    next = _mm256_set1_epi16((short)step->target);
+  } else {
+    next = _mm256_add_epi16(pc, _mm256_set1_epi16((short)step->length));
+    next = _mm256_add_epi16(next, _mm256_and_si256(skip, _mm256_set1_epi16((short)step->skip_length)));
+  }
+  pc = _mm256_blendv_epi8(pc, next, group);
+  store(&batch->PC[l], pc);
+
+  if (step->i_op != I_KEEP) {
+    __m256i i = load(&batch->I[l]);
+    __m256i vx = _mm256_cvtepu8_epi16(vx8);
+    __m256i value;
+    if (step->i_op == I_LOAD) {
+      value = _mm256_set1_epi16((short)step->target);
+    } else if (step->i_op == I_ADD) {
+      value = _mm256_add_epi16(i, vx);
+    } else {
+      value = _mm256_add_epi16(_mm256_set1_epi16(FONTSET_ADDRESS),
+                               _mm256_mullo_epi16(vx, _mm256_set1_epi16(FONTSET_BYTES_PER_CHAR)));
+    }
+    i = _mm256_blendv_epi8(i, value, group);
+    store(&batch->I[l], i);
+
+    stray = _mm256_and_si256(_mm256_cmpgt_epi16(i, _mm256_set1_epi16(MEM_SIZE - 1)),
+                             _mm256_set1_epi16(PC_STRAY));
+  }
+
+  __m256i retired = load(&batch->retired[l]);
+  retired = _mm256_add_epi16(retired, _mm256_and_si256(group, _mm256_set1_epi16((short)step->retire)));
+  retired = _mm256_add_epi16(retired, _mm256_and_si256(_mm256_and_si256(group, skip),
+                                                       _mm256_set1_epi16((short)step->skip_retire)));
+  store(&batch->retired[l], retired);
+
+  // lanes that used up the budget drop out as PC_DONE
+  __m256i budget = _mm256_set1_epi16((short)step->budget);
+  __m256i done = _mm256_cmpeq_epi16(_mm256_max_epu16(retired, budget), retired);
+  __m256i next_pc = load(&batch->next_pc[l]);
+  __m256i next_pc_value = _mm256_or_si256(_mm256_or_si256(pc, done), stray);
+  store(&batch->next_pc[l], _mm256_blendv_epi8(next_pc, next_pc_value, group));
+}
+
+// Executes insn for every lane in the group, 32 lanes per iteration.
+// Semantics mirror exec_insn() and exec_fused() in chip8.c.
+static AVX2 void run_group(Chip8Batch* batch, uint16_t pc, uint16_t budget) {
+  const Chip8Insn* insn = &batch->code[pc];
+  const Chip8Insn* second = &batch->code[pc + 2];
+  uint8_t x = insn->x;
+  uint8_t y = insn->y;
+
+  GroupStep step = {
+      .jump = (insn->op == OP_JP || insn->op == OP_CALL) && insn->fuse == FUSE_NONE,
+      .target = insn->nnn,
+      .length = 2,
+      .skip_length = 2,
+      .retire = 1,
+      .skip_retire = 0,
+      .i_op = I_KEEP,
+      .budget = budget,
+  };
+  if (insn->fuse == FUSE_ADD_SKIP) {
+    step.length = 4;
+    step.retire = 2;
+  } else if (insn->fuse == FUSE_DELAY_WAIT) {
+    // spinning lanes go back to the FX07 having run all three; lanes whose
+    // timer ran out skip the jump, retiring two
+    step.length = 0;
+    step.skip_length = 6;
+    step.retire = 3;
+    step.skip_retire = (uint16_t)-1;
+  } else if (insn->op == OP_RET) {
+    step.length = 0;  // PC is set per lane from its stack
+  } else if (insn->op == OP_LD_I) {
+    step.i_op = I_LOAD;
+  } else if (insn->op == OP_ADD_I) {
+    step.i_op = I_ADD;
+  } else if (insn->op == OP_LD_F) {
+    step.i_op = I_FONT;
+  }
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi8(-1);
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i nn = _mm256_set1_epi8((char)insn->nn);
+  const __m256i bit_of = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4,
+                                          8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  uint64_t lanes = 0;
+  uint64_t skipped = 0;
+
+  for (int c = 0; c < batch->stride; c += 32) {
+    __m256i group = load(&batch->group[c]);
+    if (_mm256_testz_si256(group, group)) continue;
+    unsigned group_bits = (unsigned)_mm256_movemask_epi8(group);
+    bool regroup = false;  // a lane faulted and stays where it is
+
+    __m256i vx = load(&batch->V[x][c]);
+    __m256i vy = load(&batch->V[y][c]);
+    __m256i result = vx;
+    __m256i flag = zero;
+    __m256i skip = zero;
+    bool writes_vx = true;
+    bool writes_vf = false;
+
+    switch (insn->fuse == FUSE_NONE ? insn->op : OP_NONE) {
+      case OP_NONE:
+        if (insn->fuse == FUSE_ADD_SKIP) {
+          // 7XNN, then 3XNN/4XNN on the updated registers
+          store(&batch->V[x][c], _mm256_blendv_epi8(vx, _mm256_add_epi8(vx, nn), group));
+          __m256i vs = load(&batch->V[second->x][c]);
+          __m256i equal = _mm256_cmpeq_epi8(vs, _mm256_set1_epi8((char)second->nn));
+          skip = second->op == OP_SE_IMM ? equal : _mm256_xor_si256(equal, ones);
+          writes_vx = false;
+        } else {
+          // FX07 3X00 1NNN: skip marks the lanes leaving the loop
+          result = load(&batch->delay_timer[c]);
+          skip = _mm256_cmpeq_epi8(result, zero);
+        }
+        break;
+      case OP_SE_IMM:
+        skip = _mm256_cmpeq_epi8(vx, nn);
+        writes_vx = false;
+        break;
+      case OP_SNE_IMM:
+        skip = _mm256_xor_si256(_mm256_cmpeq_epi8(vx, nn), ones);
+        writes_vx = false;
+        break;
+      case OP_SE_REG:
+        skip = _mm256_cmpeq_epi8(vx, vy);
+        writes_vx = false;
+        break;
+      case OP_SNE_REG:
+        skip = _mm256_xor_si256(_mm256_cmpeq_epi8(vx, vy), ones);
+        writes_vx = false;
+        break;
+      case OP_LD_IMM:
+        result = nn;
+        break;
+      case OP_ADD_IMM:
+        result = _mm256_add_epi8(vx, nn);
+        break;
+      case OP_LD_REG:
+        result = vy;
+        break;
+      case OP_OR:
+        result = _mm256_or_si256(vx, vy);
+        break;
+      case OP_AND:
+        result = _mm256_and_si256(vx, vy);
+        break;
+      case OP_XOR:
+        result = _mm256_xor_si256(vx, vy);
+        break;
+      case OP_ADD_REG:
+        // carry when the wrapped sum is below VX
+        result = _mm256_add_epi8(vx, vy);
+        flag = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(result, vx), result), one);
+        writes_vf = true;
+        break;
+      case OP_SUB:
+        result = _mm256_sub_epi8(vx, vy);
+        flag = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(vx, vy), vx), one);
+        writes_vf = true;
+        break;
+      case OP_SUBN:
+        result = _mm256_sub_epi8(vy, vx);
+        flag = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(vx, vy), vy), one);
+        writes_vf = true;
+        break;
+      case OP_SHR:
+        result = _mm256_and_si256(_mm256_srli_epi16(vx, 1), _mm256_set1_epi8(0x7F));
+        flag = _mm256_and_si256(vx, one);
+        writes_vf = true;
+        break;
+      case OP_SHL:
+        result = _mm256_add_epi8(vx, vx);
+        flag = _mm256_and_si256(_mm256_srli_epi16(vx, 7), one);
+        writes_vf = true;
+        break;
+      case OP_SKP:
+      case OP_SKNP: {
+        __m256i key = _mm256_and_si256(vx, _mm256_set1_epi8(0x0F));
+        __m256i high = _mm256_cmpgt_epi8(key, _mm256_set1_epi8(7));
+        __m256i bits = _mm256_blendv_epi8(load(&batch->keys_lo[c]), load(&batch->keys_hi[c]), high);
+        __m256i up = _mm256_cmpeq_epi8(_mm256_and_si256(bits, _mm256_shuffle_epi8(bit_of, key)), zero);
+        skip = insn->op == OP_SKNP ? up : _mm256_xor_si256(up, ones);
+        writes_vx = false;
+        break;
+      }
+      case OP_CALL:
+        // every lane pushes the same return address, only depths differ
+        for (unsigned bits = group_bits; bits; bits &= bits - 1) {
+          int l = c + __builtin_ctz(bits);
+          if (batch->SP[l] >= STACK_SIZE) {
+            fault_lane(batch, l, CHIP8_FAULT_STACK_OVERFLOW);
+            batch->group[l] = 0;
+            regroup = true;
+            continue;
+          }
+          batch->stack[batch->SP[l]++][l] = pc + 2;
+        }
+        writes_vx = false;
+        break;
+      case OP_RET:
+        for (unsigned bits = group_bits; bits; bits &= bits - 1) {
+          int l = c + __builtin_ctz(bits);
+          if (batch->SP[l] == 0) {
+            fault_lane(batch, l, CHIP8_FAULT_STACK_UNDERFLOW);
+            batch->group[l] = 0;
+            regroup = true;
+            continue;
+          }
+          batch->PC[l] = batch->stack[--batch->SP[l]][l];
+        }
+        writes_vx = false;
+        break;
+      case OP_LD_VX_DT:
+        result = load(&batch->delay_timer[c]);
+        break;
+      case OP_LD_DT:
+        store(&batch->delay_timer[c], _mm256_blendv_epi8(load(&batch->delay_timer[c]), vx, group));
+        writes_vx = false;
+        break;
+      case OP_LD_ST:
+        store(&batch->sound_timer[c], _mm256_blendv_epi8(load(&batch->sound_timer[c]), vx, group));
+        writes_vx = false;
+        break;
+      default:  // OP_JP, OP_LD_I, OP_ADD_I, OP_LD_F
+        writes_vx = false;
+        break;
+    }
+
+    if (regroup) {
+      group = load(&batch->group[c]);
+      group_bits = (unsigned)_mm256_movemask_epi8(group);
+    }
+
+    // VF first, so a result in VF itself wins like in the scalar core
+    if (writes_vf) {
+      store(&batch->V[0xF][c], _mm256_blendv_epi8(load(&batch->V[0xF][c]), flag, group));
+    }
+    if (writes_vx) {
+      store(&batch->V[x][c], _mm256_blendv_epi8(vx, result, group));
+    }
+
+    lanes += __builtin_popcount(group_bits);
+    skipped += __builtin_popcount(group_bits & (unsigned)_mm256_movemask_epi8(skip));
+
+    advance16(batch, c, _mm256_castsi256_si128(group), _mm256_castsi256_si128(skip),
+              _mm256_castsi256_si128(vx), &step);
+    advance16(batch, c + 16, _mm256_extracti128_si256(group, 1), _mm256_extracti128_si256(skip, 1),
+              _mm256_extracti128_si256(vx, 1), &step);
+  }
+
+  batch->vector_insns += lanes * step.retire + skipped * (int16_t)step.skip_retire;
+}
+
+// Lanes that start the frame with I out of range, e.g. after FX1E ended the
+// last one, go to chip8_execute() first.
+static AVX2 void mark_strays(Chip8Batch* batch) {
+  for (int l = 0; l < batch->stride; l += 16) {
+    __m256i oob = _mm256_cmpgt_epi16(load(&batch->I[l]), _mm256_set1_epi16(MEM_SIZE - 1));
+    __m256i next_pc = load(&batch->next_pc[l]);
+    store(&batch->next_pc[l], _mm256_or_si256(next_pc, _mm256_and_si256(oob, _mm256_set1_epi16(PC_STRAY))));
+  }
+}
+
+static AVX2 void tick_lanes(Chip8Batch* batch) {
+  const __m256i one = _mm256_set1_epi8(1);
+  for (int l = 0; l < batch->stride; l += 32) {
+    store(&batch->delay_timer[l], _mm256_subs_epu8(load(&batch->delay_timer[l]), one));
+    store(&batch->sound_timer[l], _mm256_subs_epu8(load(&batch->sound_timer[l]), one));
+  }
+}
+
+#endif  // BATCH_KERNELS
+
+// Lanes' Chip8s are far apart and cold by the time their group comes up;
+// start loading the next one while this one runs.
+static inline void prefetch_next_lane(const Chip8Batch* batch, int lane, uint16_t pc) {
+  for (int n = lane + 1; n < batch->lanes && n < lane + 8; n++) {
+    if (!batch->group[n]) continue;
+    const Chip8* next = &batch->machines[n];
+    __builtin_prefetch(next->V);
+    __builtin_prefetch(&next->dirty[pc / 8]);
+    __builtin_prefetch(&next->memory[pc]);
+    __builtin_prefetch(&next->memory[batch->I[n] % MEM_SIZE]);
+    return;
+  }
+}
+
+static void start_window(Chip8Batch* batch, int frames) {
+  batch->frames_left = frames;
+  batch->window_runs = batch->lane_runs;
+  batch->window_vector = batch->vector_insns;
+  batch->window_scalar = batch->scalar_insns;
+}
+
+bool chip8_batch_init(Chip8Batch* batch, int lanes, const char* romPath, const uint32_t* seeds) {
+  memset(batch, 0, sizeof(*batch));
+  if (lanes < 1) {
+    fprintf(stderr, "A batch needs at least one lane\n");
+    return false;
+  }
+
+  batch->lanes = lanes;
+  batch->stride = (lanes + CHIP8_BATCH_LANE_ALIGN - 1) / CHIP8_BATCH_LANE_ALIGN * CHIP8_BATCH_LANE_ALIGN;
+  size_t stride = batch->stride;
+
+  batch->V[0] = calloc(stride, REG_SIZE);
+  batch->PC = calloc(stride, sizeof(uint16_t));
+  batch->I = calloc(stride, sizeof(uint16_t));
+  batch->delay_timer = calloc(stride, 1);
+  batch->sound_timer = calloc(stride, 1);
+  batch->SP = calloc(stride, 1);
+  batch->stack[0] = calloc(stride * STACK_SIZE, sizeof(uint16_t));
+  batch->retired = calloc(stride, sizeof(uint16_t));
+  batch->next_pc = calloc(stride, sizeof(uint16_t));
+  batch->group = calloc(stride, 1);
+  batch->keys_lo = calloc(stride, 1);
+  batch->keys_hi = calloc(stride, 1);
+  batch->machines = calloc(lanes, sizeof(Chip8));
+  batch->initial = calloc(1, sizeof(Chip8));
+  if (batch->V[0] == NULL || batch->PC == NULL || batch->I == NULL || batch->delay_timer == NULL ||
+      batch->sound_timer == NULL || batch->SP == NULL || batch->stack[0] == NULL || batch->retired == NULL ||
+      batch->next_pc == NULL || batch->group == NULL || batch->keys_lo == NULL || batch->keys_hi == NULL ||
+      batch->machines == NULL || batch->initial == NULL) {
+    fprintf(stderr, "Unable to allocate %d lanes\n", lanes);
+    chip8_batch_free(batch);
+    return false;
+  }
+  for (int r = 1; r < REG_SIZE; r++) {
+    batch->V[r] = &batch->V[0][r * stride];
+  }
+  for (int d = 1; d < STACK_SIZE; d++) {
+    batch->stack[d] = &batch->stack[0][d * stride];
+  }
+
+  // load once, then copy: every lane starts from the same memory image
+  Chip8* first = batch->initial;
+  chip8_init(first);
+  if (!chip8_load_rom(first, romPath)) {
+    chip8_batch_free(batch);
+    return false;
+  }
+
+  // the interpreter's decode of the rom, which lanes then invalidate
+  memcpy(batch->code, first->code, sizeof(batch->code));
+
+  for (int l = 0; l < lanes; l++) {
+    batch->machines[l] = *first;
+    chip8_seed(&batch->machines[l], seeds ? seeds[l] : (uint32_t)l + 1);
+    scatter(batch, l);
+  }
+  // padding lanes never run
+  for (size_t l = 0; l < stride; l++) {
+    batch->next_pc[l] = PC_DONE;
+  }
+
+  batch->vector_insns = 0;
+  batch->scalar_insns = 0;
+  batch->lane_runs = 0;
+  batch->faulted = 0;
+#ifdef BATCH_KERNELS
+  batch->kernels = __builtin_cpu_supports("avx2");
+#else
+  batch->kernels = false;
+#endif
+  batch->vector = batch->kernels;
+  batch->stay_frames = STAY_FRAMES;
+  start_window(batch, PROBE_FRAMES);
+  return true;
+}
+
+// Every lane straight through chip8_execute() on its own Chip8, exactly
+// like separate machines; the lane arrays are not used.
+static void run_frame_plain(Chip8Batch* batch, uint16_t budget) {
+  for (int l = 0; l < batch->lanes; l++) {
+    Chip8* chip = &batch->machines[l];
+    int retired = 0;
+    while (retired < budget) {
+      retired += chip8_execute(chip);
+    }
+    chip8_tick(chip);
+    batch->scalar_insns += retired;
+  }
+}
+
+#ifdef BATCH_KERNELS
+static void run_frame_vector(Chip8Batch* batch, uint16_t budget) {
+  memset(batch->retired, 0, batch->stride * sizeof(uint16_t));
+  memcpy(batch->next_pc, batch->PC, batch->lanes * sizeof(uint16_t));
+  if (batch->faulted > 0) {
+    for (int l = 0; l < batch->lanes; l++) {
+      if (batch->machines[l].fault != CHIP8_FAULT_NONE) batch->next_pc[l] = PC_DONE;
+    }
+  }
+  mark_strays(batch);
+  snapshot_keys(batch);
+
+  // Lowest PC first: lanes that fell behind catch up and rejoin the rest.
+  for (;;) {
+    uint16_t pc = lowest_pc(batch);
+    if (pc == PC_DONE) break;
+    select_group(batch, pc);
+
+    if (pc < MEM_SIZE - 2 && runs_lane_parallel(&batch->code[pc])) {
+      run_group(batch, pc, budget);
+      continue;
+    }
+
+    for (int l = 0; l < batch->lanes; l++) {
+      // skip 8 lanes at a time while the group is sparse
+      uint64_t word;
+      if (l % 8 == 0 && (memcpy(&word, &batch->group[l], sizeof(word)), word == 0)) {
+        l += 7;
+        continue;
+      }
+      if (!batch->group[l]) continue;
+      prefetch_next_lane(batch, l, pc & ~PC_STRAY);
+      int retired = run_lane(batch, l, budget - batch->retired[l]);
+      batch->lane_runs++;
+      batch->scalar_insns += retired;
+      batch->retired[l] += retired;
+      batch->next_pc[l] = batch->retired[l] >= budget ? PC_DONE : batch->PC[l];
+      if (batch->machines[l].fault != CHIP8_FAULT_NONE) fault_lane(batch, l, batch->machines[l].fault);
+    }
+  }
+
+  tick_lanes(batch);
+}
+
+// Lane arrays to machines; the plain path runs on machines alone.
+static void leave_vector(Chip8Batch* batch) {
+  for (int l = 0; l < batch->lanes; l++) {
+    gather(batch, l);
+  }
+  batch->vector = false;
+}
+
+static void enter_vector(Chip8Batch* batch) {
+  // the plain path does not track writes; drop shared decode wherever a
+  // lane's memory no longer matches the image it was decoded from
+  const uint8_t* image = batch->initial->memory;
+  for (int l = 0; l < batch->lanes; l++) {
+    const uint8_t* memory = batch->machines[l].memory;
+    if (memcmp(memory, image, MEM_SIZE) == 0) continue;
+    for (unsigned a = 0; a < MEM_SIZE; a++) {
+      if (memory[a] != image[a]) invalidate_shared(batch, (uint16_t)a, 1);
+    }
+  }
+  batch->faulted = 0;
+  for (int l = 0; l < batch->lanes; l++) {
+    scatter(batch, l);
+    if (batch->machines[l].fault != CHIP8_FAULT_NONE) batch->faulted++;
+  }
+  batch->vector = true;
+}
+
+// Whether the window just run through the kernels would have been cheaper
+// than running the lanes one after another. Each fallback gathers and
+// scatters a lane, so a rom that keeps splitting its lanes loses.
+static bool kernels_pay(const Chip8Batch* batch) {
+  uint64_t runs = batch->lane_runs - batch->window_runs;
+  uint64_t vector = batch->vector_insns - batch->window_vector;
+  uint64_t scalar = batch->scalar_insns - batch->window_scalar;
+  return runs < (uint64_t)batch->lanes * PROBE_FRAMES && vector * 100 >= (vector + scalar) * MIN_VECTOR_PERCENT;
+}
+
+// End of a window: after a stay on the plain path the kernels get another
+// try, and a try through the kernels decides which path runs next.
+static void choose_path(Chip8Batch* batch) {
+  if (!batch->vector) {
+    enter_vector(batch);
+  } else if (kernels_pay(batch)) {
+    batch->stay_frames = STAY_FRAMES;
+  } else {
+    leave_vector(batch);
+    start_window(batch, batch->stay_frames);
+    if (batch->stay_frames < MAX_STAY_FRAMES) batch->stay_frames *= 2;
+    return;
+  }
+  start_window(batch, PROBE_FRAMES);
+}
+#endif
+
+void chip8_batch_run_frame(Chip8Batch* batch, int insns_per_frame) {
+  uint16_t budget = insns_per_frame < 1 ? 1 : insns_per_frame > MAX_BUDGET ? MAX_BUDGET : insns_per_frame;
+
+#ifdef BATCH_KERNELS
+  if (batch->vector && !batch->kernels) leave_vector(batch);
+  if (batch->vector) {
+    run_frame_vector(batch, budget);
+  } else {
+    run_frame_plain(batch, budget);
+  }
+  if (batch->kernels && --batch->frames_left <= 0) choose_path(batch);
+#else
+  run_frame_plain(batch, budget);
+#endif
+}
+
+void chip8_batch_reset_lane(Chip8Batch* batch, int lane, uint32_t seed) {
+  // Shared decode entries dropped by earlier writes stay dropped; those
+  // lanes just run through chip8_execute().
+  if (batch->vector && batch->machines[lane].fault != CHIP8_FAULT_NONE) batch->faulted--;
+  batch->machines[lane] = *batch->initial;
+  chip8_seed(&batch->machines[lane], seed);
+  if (batch->vector) scatter(batch, lane);
+}
+
+Chip8* chip8_batch_lane(Chip8Batch* batch, int lane) {
+  if (batch->vector) gather(batch, lane);
+  return &batch->machines[lane];
+}
+
+void chip8_batch_free(Chip8Batch* batch) {
+  free(batch->V[0]);
+  free(batch->PC);
+  free(batch->I);
+  free(batch->delay_timer);
+  free(batch->sound_timer);
+  free(batch->SP);
+  free(batch->stack[0]);
+  free(batch->retired);
+  free(batch->next_pc);
+  free(batch->group);
+  free(batch->keys_lo);
+  free(batch->keys_hi);
+  free(batch->machines);
+  if (batch->initial != NULL) chip8_free(batch->initial);  // lanes share its code
+  free(batch->initial);
+  memset(batch, 0, sizeof(*batch));
+}
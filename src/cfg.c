@@ -0,0 +1,134 @@
+#include "cfg.h"
+
+#include <string.h>
+
+#include "decode.h"
+
+// Internal marker so an address is only queued once.
+#define CFG_QUEUED 0x80
+
+static inline Chip8Insn insn_at(const uint8_t* memory, uint16_t addr) {
+  return chip8_decode((uint16_t)(memory[addr] << 8) | memory[addr + 1]);
+}
+
+static inline bool in_rom(const Chip8Cfg* cfg, uint32_t addr) {
+  return addr >= cfg->start && addr + 1 < cfg->end;
+}
+
+int chip8_cfg_successors(const Chip8Cfg* cfg, const uint8_t* memory, uint16_t addr, uint16_t succ[2]) {
+  Chip8Insn insn = insn_at(memory, addr);
+  uint32_t cand[2];
+  int n = 0;
+
+  switch (insn.op) {
+    case OP_JP:
+      cand[n++] = insn.nnn;
+      break;
+    case OP_JP_V:
+    case OP_RET:
+      break;
+    default:
+      cand[n++] = addr + 2;
+      if (chip8_insn_is_skip(&insn)) cand[n++] = addr + 4;
+      break;
+  }
+
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    if (in_rom(cfg, cand[i])) succ[count++] = (uint16_t)cand[i];
+  }
+  return count;
+}
+
+static void mark_leader(Chip8Cfg* cfg, uint32_t addr) {
+  if (in_rom(cfg, addr)) cfg->flags[addr] |= CFG_LEADER;
+}
+
+void chip8_cfg_analyze(const uint8_t* memory, uint16_t start, uint16_t end, Chip8Cfg* cfg) {
+  // every address is queued at most once, so MEM_SIZE entries always suffice
+  uint16_t worklist[MEM_SIZE];
+  int top = 0;
+
+  memset(cfg->flags, 0, sizeof(cfg->flags));
+  cfg->start = start;
+  cfg->end = end > MEM_SIZE ? MEM_SIZE : end;
+
+  if (!in_rom(cfg, start)) return;
+
+  cfg->flags[start] |= CFG_LEADER | CFG_ENTRY | CFG_QUEUED;
+  worklist[top++] = start;
+
+  while (top > 0) {
+    uint16_t addr = worklist[--top];
+
+    // walk straight-line code until a terminator or already-visited insn
+    while (in_rom(cfg, addr)) {
+      if (cfg->flags[addr] & CFG_INSN) {
+        // reached along a second path, so a block starts here
+        cfg->flags[addr] |= CFG_LEADER;
+        break;
+      }
+
+      Chip8Insn insn = insn_at(memory, addr);
+      cfg->flags[addr] |= CFG_INSN | CFG_CODE;
+      cfg->flags[addr + 1] |= CFG_CODE;
+
+      if (insn.op == OP_CALL && in_rom(cfg, insn.nnn)) {
+        cfg->flags[insn.nnn] |= CFG_ENTRY | CFG_LEADER;
+        if (!(cfg->flags[insn.nnn] & CFG_QUEUED)) {
+          cfg->flags[insn.nnn] |= CFG_QUEUED;
+          worklist[top++] = insn.nnn;
+        }
+      }
+      if (insn.op == OP_JP_V) cfg->flags[addr] |= CFG_INDIRECT;
+
+      uint16_t succ[2];
+      int n = chip8_cfg_successors(cfg, memory, addr, succ);
+
+      // a single fall-through successor continues the current block
+      bool branches = insn.op == OP_JP || insn.op == OP_CALL || n > 1;
+      if (!branches && n == 1) {
+        addr = succ[0];
+        continue;
+      }
+
+      for (int i = 0; i < n; i++) {
+        mark_leader(cfg, succ[i]);
+        if (!(cfg->flags[succ[i]] & CFG_QUEUED)) {
+          cfg->flags[succ[i]] |= CFG_QUEUED;
+          worklist[top++] = succ[i];
+        }
+      }
+      break;
+    }
+  }
+
+  for (uint32_t addr = cfg->start; addr < cfg->end; addr++) {
+    cfg->flags[addr] &= ~CFG_QUEUED;
+
+    if ((cfg->flags[addr] & CFG_INSN) && addr + 1 < cfg->end) {
+      Chip8Insn insn = insn_at(memory, addr);
+      if (insn.op == OP_LD_I && insn.nnn >= cfg->start && insn.nnn < cfg->end &&
+          !(cfg->flags[insn.nnn] & CFG_CODE)) {
+        cfg->flags[insn.nnn] |= CFG_SPRITE;
+      }
+    }
+  }
+}
+
+uint16_t chip8_cfg_block_last(const Chip8Cfg* cfg, const uint8_t* memory, uint16_t leader) {
+  uint16_t addr = leader;
+
+  for (;;) {
+    Chip8Insn insn = insn_at(memory, addr);
+    if (chip8_insn_is_terminator(&insn) || chip8_insn_is_skip(&insn) || insn.op == OP_CALL) {
+      return addr;
+    }
+
+    uint32_t next = addr + 2u;
+    if (!in_rom(cfg, next) || !(cfg->flags[next] & CFG_INSN) || (cfg->flags[next] & CFG_LEADER)) {
+      return addr;
+    }
+    addr = (uint16_t)next;
+  }
+}
@@ -1,19 +1,12 @@
 #include "chip8.h"
-#include "audio.h"
+#include "decode.h"
+#include "timing.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#define X(op) ((op & 0x0F00) >> 8)
-#define Y(op) ((op & 0x00F0) >> 4)
-#define N(op) (op & 0x000F)
-#define NN(op) (op & 0x00FF)
-#define NNN(op) (op & 0x0FFF)
-
-#define FONTSET_ADDRESS 0x50
-#define FONTSET_BYTES_PER_CHAR 5
 unsigned char chip8_fontset[80] =
     {
         0xF0, 0x90, 0x90, 0x90, 0xF0,  // 0
@@ -34,83 +27,158 @@ unsigned char chip8_fontset[80] =
         0xF0, 0x80, 0xF0, 0x80, 0x80   // F
 };
 
-uint8_t memory[MEM_SIZE];  // 4kB RAM
-// 16 (8bit) registers 0-F called V0-VF
-// VF can be used as a carry flag or can be set to 1 or 0 based on some rule.
-uint8_t V[REG_SIZE];
-uint16_t I;   // used to point at locations in memory
-uint16_t PC;  // points at the current instruction in memory
-uint16_t stack[STACK_SIZE];
-uint8_t SP;  // stack_pointer
-uint8_t delay_timer;
-uint8_t sound_timer;
-uint8_t screen[SCREEN_SIZE];
-bool keys[KEY_SIZE];
-bool chip8_draw_flag;
-
-// Debug write helper: detects writes into ROM area and specific addresses
-static void debug_mem_write(uint16_t addr, uint8_t value, const char* why) {
-  // detect writes to ROM region (0x200–0xFFF where ROM lives)
-  if (addr < 0x200) {
-    fprintf(stderr, "WARN: memory write to ROM[0x%03X] = 0x%02X (%s)\n", addr, value, why);
+static inline uint16_t opcode_at(const Chip8* chip, unsigned addr) {
+  return (uint16_t)(chip->memory[addr] << 8) | chip->memory[addr + 1];
+}
+
+// Decodes addr into insn, fusing it with the next two instructions when
+// they form one of the Chip8Fuse sequences.
+static void decode_at(const Chip8* chip, uint16_t addr, Chip8Insn* insn) {
+  *insn = chip8_decode(opcode_at(chip, addr));
+#ifndef CHIP8_NO_FUSE
+  if (addr + 5u < MEM_SIZE) {
+    Chip8Insn b = chip8_decode(opcode_at(chip, addr + 2));
+    Chip8Insn c = chip8_decode(opcode_at(chip, addr + 4));
+    insn->fuse = chip8_fuse(insn, &b, &c, addr);
   }
+#endif
+}
+
+// The instruction at addr from the rom's decode table, or decoded into
+// scratch when memory there has been written since the rom was loaded.
+static inline const Chip8Insn* cached_insn(const Chip8* chip, uint16_t addr, Chip8Insn* scratch) {
+  if (!(chip->dirty[addr / 8] & (1u << (addr % 8)))) return &chip->code[addr];
+  decode_at(chip, addr, scratch);
+  return scratch;
+}
 
-  // detect writes to the problematic loop area
-  if (addr == 0x3DC || addr == 0x3DE) {
-    fprintf(stderr, "TRACE: write to 0x%03X = 0x%02X (%s)\n", addr, value, why);
+static inline void invalidate_decoded(Chip8* chip, uint16_t addr, unsigned len) {
+  // a fused entry up to 5 bytes earlier may cover addr
+  unsigned from = addr > 5 ? addr - 5u : 0u;
+  unsigned to = addr + len;
+  if (to > MEM_SIZE) to = MEM_SIZE;
+  for (unsigned a = from; a < to; a++) {
+    chip->dirty[a / 8] |= 1u << (a % 8);
   }
+}
 
-  memory[addr] = value;
+// xorshift32, kept per machine so instances never share random state
+static inline uint8_t randByte(Chip8* chip) {
+  uint32_t r = chip->rng;
+  r ^= r << 13;
+  r ^= r >> 17;
+  r ^= r << 5;
+  chip->rng = r;
+  return r >> 24;
 }
 
-static inline uint8_t randByte() { return (rand() % 256); }
+void chip8_seed(Chip8* chip, uint32_t seed) {
+  chip->rng = seed ? seed : 0x9E3779B9u;  // xorshift state must be non-zero
+}
 
-void chip8_init() {
-  PC = 0x200;
-  I = 0;
-  SP = 0;
+void chip8_init(Chip8* chip) {
+  chip->PC = 0x200;
+  chip->I = 0;
+  chip->SP = 0;
 
-  memset(memory, 0, sizeof(memory));
-  memset(V, 0, sizeof(V));
-  memset(screen, 0, sizeof(screen));
-  memset(keys, false, sizeof(keys));
+  memset(chip->memory, 0, sizeof(chip->memory));
+  memset(chip->V, 0, sizeof(chip->V));
+  memset(chip->screen, 0, sizeof(chip->screen));
+  memset(chip->keys, false, sizeof(chip->keys));
+  // no decode table until a rom is loaded, so every fetch decodes
+  memset(chip->dirty, 0xFF, sizeof(chip->dirty));
+  chip->code = NULL;
 
   // 050–09F key memory mapping
   for (int i = 0; i < 80; i++) {
-    memory[FONTSET_ADDRESS + i] = chip8_fontset[i];
+    chip->memory[FONTSET_ADDRESS + i] = chip8_fontset[i];
   }
 
-  chip8_draw_flag = false;
-  delay_timer = 0;
-  sound_timer = 0;
-  srand(time(NULL));
+  chip->draw_flag = false;
+  chip->fault = CHIP8_FAULT_NONE;
+  chip->vip_cycles = 0;
+  chip->vip_vblank_wait = false;
+  chip->delay_timer = 0;
+  chip->sound_timer = 0;
+  chip8_seed(chip, (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)chip);
 }
 
-void chip8_load_rom(char* romPath) {
+bool chip8_load_rom(Chip8* chip, const char* romPath) {
   FILE* rom;
   rom = fopen(romPath, "rb");
 
   if (rom == NULL) {
-    fprintf(stderr, "Unable to open rom file: %p\n", rom);
-    exit(42);
+    fprintf(stderr, "Unable to open rom file: %s\n", romPath);
+    return false;
   }
 
-  fread(&memory[0x200], 1, MAX_ROM_SIZE, rom);
+  fread(&chip->memory[0x200], 1, MAX_ROM_SIZE, rom);
 
   fclose(rom);
+
+  // decode every address once; fetches then only check the dirty bits
+  Chip8Insn* code = calloc(MEM_SIZE, sizeof(Chip8Insn));
+  if (code == NULL) {
+    fprintf(stderr, "Unable to allocate the decode table for: %s\n", romPath);
+    return false;
+  }
+  for (unsigned addr = 0; addr + 1 < MEM_SIZE; addr++) {
+    code[addr] = chip8_decode(opcode_at(chip, addr));
+  }
+#ifndef CHIP8_NO_FUSE
+  // same fusion as decode_at(); later entries are not fused yet when read
+  for (unsigned addr = 0; addr + 5 < MEM_SIZE; addr++) {
+    code[addr].fuse = chip8_fuse(&code[addr], &code[addr + 2], &code[addr + 4], (uint16_t)addr);
+  }
+#endif
+  chip->code = code;
+  memset(chip->dirty, 0, sizeof(chip->dirty));
+  return true;
+}
+
+void chip8_free(Chip8* chip) {
+  free((Chip8Insn*)chip->code);
+  chip->code = NULL;
+}
+
+const char* chip8_fault_name(Chip8Fault fault) {
+  switch (fault) {
+    case CHIP8_FAULT_NONE:
+      return "no fault";
+    case CHIP8_FAULT_PC:
+      return "PC out of bounds";
+    case CHIP8_FAULT_I:
+      return "I out of bounds";
+    case CHIP8_FAULT_STACK_UNDERFLOW:
+      return "stack underflow";
+    case CHIP8_FAULT_STACK_OVERFLOW:
+      return "stack overflow";
+  }
+  return "unknown fault";
+}
+
+// Stops the machine with PC left on the faulting instruction.
+static inline void raise_fault(Chip8* chip, Chip8Fault fault) {
+  chip->fault = fault;
+}
+
+// Same, from inside exec_insn() where PC already points past it.
+static inline void insn_fault(Chip8* chip, Chip8Fault fault) {
+  chip->PC -= 2;
+  raise_fault(chip, fault);
 }
 
-static inline void clear_display() {
-  memset(screen, 0, sizeof(screen));
+static inline void clear_display(Chip8* chip) {
+  memset(chip->screen, 0, sizeof(chip->screen));
 }
 
-void draw_sprite(uint8_t vx, uint8_t vy, uint8_t n) {
+static void draw_sprite(Chip8* chip, uint8_t vx, uint8_t vy, uint8_t n) {
   uint8_t row = vy;
   uint8_t col = vx;
 
-  V[0xF] = 0;
+  chip->V[0xF] = 0;
   for (unsigned byte_idx = 0; byte_idx < n; byte_idx++) {
-    uint8_t byte = memory[I + byte_idx];
+    uint8_t byte = chip->memory[chip->I + byte_idx];
     for (unsigned bit_idx = 0; bit_idx < 8; bit_idx++) {
       uint8_t bit = (byte >> (7 - bit_idx)) & 0x1;
 
@@ -125,9 +193,9 @@ void draw_sprite(uint8_t vx, uint8_t vy, uint8_t n) {
         continue;
       }
 
-      uint8_t* pixel = &screen[screen_y * SCREEN_W + screen_x];
+      uint8_t* pixel = &chip->screen[screen_y * SCREEN_W + screen_x];
       if (bit == 1 && *pixel == 1) {
-        V[0xF] = 1;
+        chip->V[0xF] = 1;
       }
 
       *pixel = *pixel ^ bit;
@@ -135,349 +203,420 @@ void draw_sprite(uint8_t vx, uint8_t vy, uint8_t n) {
   }
 }
 
-static void print_state() {
-  printf("------------------------------------------------------------------\n");
-  printf("\n");
-
-  printf("V0: 0x%02x  V4: 0x%02x  V8: 0x%02x  VC: 0x%02x\n",
-         V[0], V[4], V[8], V[12]);
-  printf("V1: 0x%02x  V5: 0x%02x  V9: 0x%02x  VD: 0x%02x\n",
-         V[1], V[5], V[9], V[13]);
-  printf("V2: 0x%02x  V6: 0x%02x  VA: 0x%02x  VE: 0x%02x\n",
-         V[2], V[6], V[10], V[14]);
-  printf("V3: 0x%02x  V7: 0x%02x  VB: 0x%02x  VF: 0x%02x\n",
-         V[3], V[7], V[11], V[15]);
-
-  printf("\n");
-  printf("PC: 0x%04x\n", PC);
-  printf("\n");
-  printf("\n");
-}
-
-uint16_t chip8_fetch() {
-  uint16_t opcode = memory[PC];
+uint16_t chip8_fetch(Chip8* chip) {
+  uint16_t opcode = chip->memory[chip->PC];
   opcode <<= 8;
-  opcode |= memory[PC + 1];
+  opcode |= chip->memory[chip->PC + 1];
 
-  PC = PC + 2;
+  chip->PC = chip->PC + 2;
 
   return opcode;
 }
 
-void debug_dump_screen() {
-  static int frame = 0;
-  char filename[64];
-  snprintf(filename, sizeof(filename), "frame_%04d.txt", frame++);
+static inline const Chip8Insn* fetch_insn(Chip8* chip, Chip8Insn* scratch) {
+  const Chip8Insn* insn = cached_insn(chip, chip->PC, scratch);
 
-  FILE* f = fopen(filename, "w");
-  for (int y = 0; y < SCREEN_H; y++) {
-    for (int x = 0; x < SCREEN_W; x++) {
-      fprintf(f, "%c", screen[SCREEN_IDX(y, x)] ? '#' : '.');
-    }
-    fprintf(f, "\n");
-  }
-  fclose(f);
-}
+  chip->PC = chip->PC + 2;
 
-void chip8_draw() {
-  if (chip8_draw_flag) {
-    debug_dump_screen();
-    chip8_draw_flag = false;
-  }
+  return insn;
 }
 
-void chip8_key_down(uint8_t key) {
+void chip8_key_down(Chip8* chip, uint8_t key) {
   if (key < 16)
-    keys[key] = true;
+    chip->keys[key] = true;
 }
 
-void chip8_key_up(uint8_t key) {
+void chip8_key_up(Chip8* chip, uint8_t key) {
   if (key < 16) {
-    keys[key] = false;
+    chip->keys[key] = false;
   }
 }
 
-void chip8_execute() {
-  uint16_t opcode = chip8_fetch();
-  uint8_t inst_type = (opcode & 0xF000) >> 12;
-  // printf("PC=0x%04X OPCODE=0x%04X\n", PC, opcode);
-  if (SP > STACK_SIZE) {
-    fprintf(stderr, "SP overflow %u\n", SP);
-    exit(1);
-  }
-  if (I >= MEM_SIZE) {
-    fprintf(stderr, "I OOB: 0x%X\n", I);
-    exit(1);
-  }
-  if (PC >= MEM_SIZE) {
-    fprintf(stderr, "PC OOB: 0x%X\n", PC);
-    exit(1);
+// Charges the VIP machine cycles of an instruction that just retired. vx is
+// V[insn->x] from before it ran; only the DXYN cost depends on it.
+static inline void charge(Chip8* chip, const Chip8Insn* insn, uint8_t vx) {
+  uint16_t cost = chip8_vip_cycles(insn, vx);
+  chip->vip_cycles += cost;
+  if (insn->op == OP_DRW) {
+    chip->vip_draw_cycles = cost;
+    chip->vip_vblank_wait = true;
   }
+}
 
-  switch (inst_type) {
-    case 0x0: {
-      switch (NN(opcode)) {
-        case 0xE0:
-          // clears the screen
-          clear_display();
-          chip8_draw_flag = true;
-          break;
-        case 0xEE: {
-          if (SP == 0) {
-            fprintf(stderr, "Stack underflow on 00EE\n");
-            exit(1);
-          }
-          PC = stack[--SP];
-          break;
-        }
-        default:
-          // do nothing for 0NNN
-          break;
+// Executes one instruction; PC already points past it.
+static void exec_insn(Chip8* chip, const Chip8Insn* insn) {
+  uint8_t x = insn->x;
+  uint8_t y = insn->y;
+
+  switch (insn->op) {
+    case OP_CLS:
+      // clears the screen
+      clear_display(chip);
+      chip->draw_flag = true;
+      break;
+    case OP_RET: {
+      if (chip->SP == 0) {
+        insn_fault(chip, CHIP8_FAULT_STACK_UNDERFLOW);
+        break;
       }
+      chip->PC = chip->stack[--chip->SP];
       break;
     }
-    case 0x1: {
-      PC = NNN(opcode);
+    case OP_SYS:
+      // do nothing for 0NNN
+      break;
+    case OP_JP: {
+      chip->PC = insn->nnn;
       break;
     }
-    case 0x2: {
+    case OP_CALL: {
       // Calls subroutine at NNN
-      stack[SP++] = PC;
-      PC = NNN(opcode);
+      if (chip->SP >= STACK_SIZE) {
+        insn_fault(chip, CHIP8_FAULT_STACK_OVERFLOW);
+        break;
+      }
+      chip->stack[chip->SP++] = chip->PC;
+      chip->PC = insn->nnn;
       break;
     }
-    case 0x3: {
-      if (V[X(opcode)] == NN(opcode)) PC += 2;
+    case OP_SE_IMM: {
+      if (chip->V[x] == insn->nn) chip->PC += 2;
       break;
     }
-    case 0x4: {
-      if (V[X(opcode)] != NN(opcode)) PC += 2;
+    case OP_SNE_IMM: {
+      if (chip->V[x] != insn->nn) chip->PC += 2;
       break;
     }
-    case 0x5: {
-      if (V[X(opcode)] == V[Y(opcode)]) PC += 2;
+    case OP_SE_REG: {
+      if (chip->V[x] == chip->V[y]) chip->PC += 2;
       break;
     }
-    case 0x6: {
+    case OP_LD_IMM: {
       // 0x6XNN
-      V[X(opcode)] = NN(opcode);
+      chip->V[x] = insn->nn;
       break;
     }
-    case 0x7: {
+    case OP_ADD_IMM: {
       // Adds NN to the VX (carry flag is not changed)
-      V[X(opcode)] += NN(opcode);
+      chip->V[x] += insn->nn;
     } break;
-    case 0x8: {
-      switch (N(opcode)) {
-        case 0x0: {  // LD Vx, Vy
-          V[X(opcode)] = V[Y(opcode)];
-          break;
-        }
+    case OP_LD_REG: {  // LD Vx, Vy
+      chip->V[x] = chip->V[y];
+      break;
+    }
 
-        case 0x1: {  // OR
-          V[X(opcode)] |= V[Y(opcode)];
-          break;
-        }
+    case OP_OR: {  // OR
+      chip->V[x] |= chip->V[y];
+      break;
+    }
 
-        case 0x2: {  // AND
-          V[X(opcode)] &= V[Y(opcode)];
-          break;
-        }
+    case OP_AND: {  // AND
+      chip->V[x] &= chip->V[y];
+      break;
+    }
 
-        case 0x3: {  // XOR
-          V[X(opcode)] ^= V[Y(opcode)];
-          break;
-        }
+    case OP_XOR: {  // XOR
+      chip->V[x] ^= chip->V[y];
+      break;
+    }
 
-        case 0x4: {  // ADD Vx, Vy (with carry)
-          uint16_t sum = V[X(opcode)] + V[Y(opcode)];
-          V[0xF] = (sum > 0xFF);
-          V[X(opcode)] = sum & 0xFF;
-          break;
-        }
+    case OP_ADD_REG: {  // ADD Vx, Vy (with carry)
+      uint16_t sum = chip->V[x] + chip->V[y];
+      chip->V[0xF] = (sum > 0xFF);
+      chip->V[x] = sum & 0xFF;
+      break;
+    }
 
-        case 0x5: {  // SUB Vx -= Vy
-          uint8_t vx = V[X(opcode)];
-          uint8_t vy = V[Y(opcode)];
-          V[0xF] = (vx >= vy);
-          V[X(opcode)] = vx - vy;
-          break;
-        }
+    case OP_SUB: {  // SUB Vx -= Vy
+      uint8_t vx = chip->V[x];
+      uint8_t vy = chip->V[y];
+      chip->V[0xF] = (vx >= vy);
+      chip->V[x] = vx - vy;
+      break;
+    }
 
-        case 0x6: {  // SHR Vx
-          uint8_t vx = V[X(opcode)];
-          V[0xF] = vx & 0x01;  // LSB
-          V[X(opcode)] = vx >> 1;
-          break;
-        }
+    case OP_SHR: {  // SHR Vx
+      uint8_t vx = chip->V[x];
+      chip->V[0xF] = vx & 0x01;  // LSB
+      chip->V[x] = vx >> 1;
+      break;
+    }
 
-        case 0x7: {  // SUBN Vx = Vy - Vx
-          uint8_t vx = V[X(opcode)];
-          uint8_t vy = V[Y(opcode)];
-          V[0xF] = (vy >= vx);  // no borrow
-          V[X(opcode)] = vy - vx;
-          break;
-        }
+    case OP_SUBN: {  // SUBN Vx = Vy - Vx
+      uint8_t vx = chip->V[x];
+      uint8_t vy = chip->V[y];
+      chip->V[0xF] = (vy >= vx);  // no borrow
+      chip->V[x] = vy - vx;
+      break;
+    }
 
-        case 0xE: {  // SHL Vx
-          uint8_t vx = V[X(opcode)];
-          V[0xF] = (vx & 0x80) >> 7;  // MSB before shift
-          V[X(opcode)] = vx << 1;
-          break;
-        }
-      }
+    case OP_SHL: {  // SHL Vx
+      uint8_t vx = chip->V[x];
+      chip->V[0xF] = (vx & 0x80) >> 7;  // MSB before shift
+      chip->V[x] = vx << 1;
       break;
     }
-    case 0x9: {                      // 9XY0 — skip if VX != VY
-      if ((opcode & 0x000F) == 0) {  // Only valid if last nibble = 0
-        if (V[X(opcode)] != V[Y(opcode)]) {
-          PC += 2;
-        }
+    case OP_SNE_REG: {  // 9XY0 — skip if VX != VY
+      if (chip->V[x] != chip->V[y]) {
+        chip->PC += 2;
       }
       break;
     }
 
-    case 0xA: {
+    case OP_LD_I: {
       // 0xANN
-      I = NNN(opcode);
+      chip->I = insn->nnn;
       break;
     }
-    case 0xB: {
+    case OP_JP_V: {
       // Ambiguous could be PC=V0 + NNN or PC=VX + NNN
-      PC = V[X(opcode)] + NNN(opcode);
+      chip->PC = chip->V[x] + insn->nnn;
       break;
     }
-    case 0xC: {
-      V[X(opcode)] = randByte() & NN(opcode);
+    case OP_RND: {
+      chip->V[x] = randByte(chip) & insn->nn;
       break;
     }
-    case 0xD: {
+    case OP_DRW: {
       // 0xDXYN
-      chip8_draw_flag = true;
-      draw_sprite(V[X(opcode)] % SCREEN_W, V[Y(opcode)] % SCREEN_H, N(opcode));
+      chip->draw_flag = true;
+      draw_sprite(chip, chip->V[x] % SCREEN_W, chip->V[y] % SCREEN_H, insn->n);
       break;
     }
-    case 0xE: {
-      uint8_t vx = V[X(opcode)] & 0xF;
-      switch (NN(opcode)) {
-        case 0x9E: {
-          if (keys[vx]) PC += 2;
-          break;
-        }
-        case 0xA1: {
-          if (!keys[vx]) PC += 2;
-          break;
-        }
-      }
+    case OP_SKP: {
+      if (chip->keys[chip->V[x] & 0xF]) chip->PC += 2;
+      break;
+    }
+    case OP_SKNP: {
+      if (!chip->keys[chip->V[x] & 0xF]) chip->PC += 2;
+      break;
+    }
+    case OP_LD_VX_DT: {
+      chip->V[x] = chip->delay_timer;
       break;
     }
-    case 0xF: {
-      switch (NN(opcode)) {
-        case 0x07: {
-          V[X(opcode)] = delay_timer;
-          break;
-        }
-
-        case 0x0A: {
-          uint8_t x = X(opcode);
-          bool key_pressed = false;
-
-          for (int k = 0; k < KEY_SIZE; k++) {
-            if (keys[k]) {
-              V[x] = k;
-              key_pressed = true;
-              break;
-            }
-          }
 
-          if (!key_pressed) {
-            PC -= 2;
-          }
+    case OP_LD_VX_K: {
+      bool key_pressed = false;
 
+      for (int k = 0; k < KEY_SIZE; k++) {
+        if (chip->keys[k]) {
+          chip->V[x] = k;
+          key_pressed = true;
           break;
         }
-        case 0x15: {
-          delay_timer = V[X(opcode)];
-          break;
-        }
-        case 0x18: {
-          sound_timer = V[X(opcode)];
-          break;
-        }
-        case 0x1E: {
-          I += V[X(opcode)];
-          break;
-        }
-        case 0x29: {
-          I = FONTSET_ADDRESS + V[X(opcode)] * FONTSET_BYTES_PER_CHAR;
-          break;
-        }
-        case 0x33: {
-          uint8_t vx = V[X(opcode)];
-          memory[I] = vx / 100;
-          memory[I + 1] = (vx / 10) % 10;
-          memory[I + 2] = vx % 10;
+      }
 
-          break;
-        }
-        case 0x55: {  // LD [I], V0..VX  (then I += X + 1)
-          uint8_t x = X(opcode);
-          for (unsigned idx = 0; idx <= x; idx++) {
-            // safety check:
-            if ((size_t)I + idx >= MEM_SIZE) {
-              fprintf(stderr, "FX55 write OOB I+%u = 0x%X\n", idx, I + idx);
-              exit(1);
-            }
-            memory[I + idx] = V[idx];
-          }
-          I = I + x + 1;
-          break;
-        }
+      if (!key_pressed) {
+        chip->PC -= 2;
+      }
 
-        case 0x65: {  // LD V0..VX, [I] (then I += X + 1)
-          uint8_t x = X(opcode);
-          for (unsigned idx = 0; idx <= x; idx++) {
-            // if ((size_t)I + idx >= MEM_SIZE) {
-            //   fprintf(stderr, "FX65 read OOB I+%u = 0x%X\n", idx, I + idx);
-            //   exit(1);
-            // }
-            V[idx] = memory[I + idx];
-          }
-          I = I + x + 1;
-          break;
-        }
+      break;
+    }
+    case OP_LD_DT: {
+      chip->delay_timer = chip->V[x];
+      break;
+    }
+    case OP_LD_ST: {
+      chip->sound_timer = chip->V[x];
+      break;
+    }
+    case OP_ADD_I: {
+      chip->I += chip->V[x];
+      break;
+    }
+    case OP_LD_F: {
+      chip->I = FONTSET_ADDRESS + chip->V[x] * FONTSET_BYTES_PER_CHAR;
+      break;
+    }
+    case OP_LD_B: {
+      uint8_t vx = chip->V[x];
+      if (chip->I + 2u >= MEM_SIZE) {
+        insn_fault(chip, CHIP8_FAULT_I);
+        break;
+      }
+      chip->memory[chip->I] = vx / 100;
+      chip->memory[chip->I + 1] = (vx / 10) % 10;
+      chip->memory[chip->I + 2] = vx % 10;
+      invalidate_decoded(chip, chip->I, 3);
+
+      break;
+    }
+    case OP_LD_MEM: {  // LD [I], V0..VX  (then I += X + 1)
+      if ((size_t)chip->I + x >= MEM_SIZE) {
+        insn_fault(chip, CHIP8_FAULT_I);
+        break;
       }
+      for (unsigned idx = 0; idx <= x; idx++) {
+        chip->memory[chip->I + idx] = chip->V[idx];
+      }
+      invalidate_decoded(chip, chip->I, x + 1);
+      chip->I = chip->I + x + 1;
+      break;
+    }
+
+    case OP_LD_REGS: {  // LD V0..VX, [I] (then I += X + 1)
+      if ((size_t)chip->I + x >= MEM_SIZE) {
+        insn_fault(chip, CHIP8_FAULT_I);
+        break;
+      }
+      for (unsigned idx = 0; idx <= x; idx++) {
+        chip->V[idx] = chip->memory[chip->I + idx];
+      }
+      chip->I = chip->I + x + 1;
       break;
     }
     default: {
-      printf("unknown_opcode: 0x%04X\n", opcode);
+      // 8XY?, 9XY?, EX??, FX?? outside the table are ignored like before
       break;
     }
   }
+}
+
+// Runs the superinstruction that starts with insn; PC already points past
+// insn. Cycles are only charged when vip is set. Returns how many CHIP-8
+// instructions were retired.
+static inline int exec_fused(Chip8* chip, const Chip8Insn* insn, bool vip) {
+  Chip8Insn scratch[2];
+  const Chip8Insn* b = cached_insn(chip, chip->PC, &scratch[0]);
+
+  switch (insn->fuse) {
+    case FUSE_ADD_SKIP: {
+      chip->V[insn->x] += insn->nn;
+      bool equal = chip->V[b->x] == b->nn;
+      chip->PC += (equal == (b->op == OP_SE_IMM)) ? 4 : 2;
+      if (vip) {
+        charge(chip, insn, 0);
+        charge(chip, b, 0);
+      }
+      return 2;
+    }
+    case FUSE_ADDI_LOAD: {
+      chip->I += chip->V[insn->x];
+      if ((size_t)chip->I + b->x >= MEM_SIZE) {
+        raise_fault(chip, CHIP8_FAULT_I);
+        return 1;
+      }
+      for (unsigned idx = 0; idx <= b->x; idx++) {
+        chip->V[idx] = chip->memory[chip->I + idx];
+      }
+      chip->I = chip->I + b->x + 1;
+      chip->PC += 2;
+      if (vip) {
+        charge(chip, insn, 0);
+        charge(chip, b, 0);
+      }
+      return 2;
+    }
+    case FUSE_SPRITE_SETUP: {
+      const Chip8Insn* third = cached_insn(chip, chip->PC + 2, &scratch[1]);
+      chip->V[insn->x] = insn->nn;
+      chip->V[b->x] = b->nn;
+      uint8_t draw_x = chip->V[third->x];  // before DXYN can overwrite VF
+      chip->draw_flag = true;
+      draw_sprite(chip, draw_x % SCREEN_W, chip->V[third->y] % SCREEN_H, third->n);
+      chip->PC += 4;
+      if (vip) {
+        charge(chip, insn, 0);
+        charge(chip, b, 0);
+        charge(chip, third, draw_x);
+      }
+      return 3;
+    }
+    case FUSE_DELAY_WAIT: {
+      chip->V[insn->x] = chip->delay_timer;
+      if (vip) {
+        charge(chip, insn, 0);
+        charge(chip, b, 0);
+      }
+      if (chip->delay_timer == 0) {
+        chip->PC += 4;  // 3X00 skips the jump
+        return 2;
+      }
+      chip->PC -= 2;  // 1NNN back to the FX07
+      if (vip) charge(chip, cached_insn(chip, chip->PC + 4, &scratch[1]), 0);
+      return 3;
+    }
+  }
 
-  // print_state();
+  uint8_t vx = chip->V[insn->x];
+  exec_insn(chip, insn);
+  if (vip) charge(chip, insn, vx);
+  return 1;
 }
 
-// sets the display and sound timers
-void chip8_tick() {
-  if (delay_timer > 0) --delay_timer;
-  if (sound_timer > 0) {
-    --sound_timer;
-    audio_beep_on();
+// chip8_execute() and the VIP scheduler share this body; vip is a constant
+// at both call sites, so the plain interpreter carries no cycle accounting.
+static inline int execute(Chip8* chip, bool vip) {
+  if (chip->fault != CHIP8_FAULT_NONE) return 1;
+  if (chip->PC >= MEM_SIZE - 2) {
+    raise_fault(chip, CHIP8_FAULT_PC);
+    return 1;
+  }
+  if (chip->I >= MEM_SIZE) {
+    raise_fault(chip, CHIP8_FAULT_I);
+    return 1;
+  }
+
+  Chip8Insn scratch;
+  const Chip8Insn* insn = fetch_insn(chip, &scratch);
+  // printf("PC=0x%04X OPCODE=0x%04X\n", PC, insn->opcode);
+
+  if (insn->fuse != FUSE_NONE) {
+    return exec_fused(chip, insn, vip);
+  }
+
+  uint8_t vx = chip->V[insn->x];  // DXYN's cost needs X from before VF changes
+  exec_insn(chip, insn);
+  if (vip) charge(chip, insn, vx);
+
+  return 1;
+}
+
+int chip8_execute(Chip8* chip) {
+  return execute(chip, false);
+}
+
+int chip8_run_frame_vip(Chip8* chip) {
+  int retired = 0;
+
+  // a DXYN that ended the last frame is drawn at the start of this one;
+  // an overrun past the budget is carried over as well
+  chip->vip_vblank_wait = false;
+  while (chip->vip_cycles < VIP_INTERPRETER_CYCLES && !chip->vip_vblank_wait &&
+         chip->fault == CHIP8_FAULT_NONE) {
+    retired += execute(chip, true);
+  }
+
+  if (chip->vip_vblank_wait) {
+    chip->vip_cycles = chip->vip_draw_cycles;
   } else {
-    audio_beep_off();
+    chip->vip_cycles -= VIP_INTERPRETER_CYCLES;
   }
+
+  chip8_tick(chip);
+  return retired;
+}
+
+// sets the display and sound timers
+void chip8_tick(Chip8* chip) {
+  if (chip->delay_timer > 0) --chip->delay_timer;
+  if (chip->sound_timer > 0) --chip->sound_timer;
+}
+
+bool chip8_sound_on(const Chip8* chip) {
+  return chip->sound_timer > 0;
 }
 
 // chip8_get_screen returns a pointer to an array of SCREEN_W uint8_t
-const uint8_t* chip8_get_screen() {
-  return screen;
+const uint8_t* chip8_get_screen(const Chip8* chip) {
+  return chip->screen;
 }
 
-bool chip8_can_draw() {
-  return chip8_draw_flag;
+bool chip8_can_draw(const Chip8* chip) {
+  return chip->draw_flag;
 }
 
-void chip8_set_draw_false() {
-  chip8_draw_flag = false;
+void chip8_set_draw_false(Chip8* chip) {
+  chip->draw_flag = false;
 }
\ No newline at end of file
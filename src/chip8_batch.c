@@ -0,0 +1,209 @@
+// src/chip8_batch.c
+// Runs one rom on many lanes with per-lane key input, once on independent
+// Chip8s and once on a Chip8Batch, checks both end in the same state and
+// reports lanes per second for each. With -c it compares them after every
+// frame instead, for each rom given (see roms/tests).
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "batch.h"
+#include "chip8.h"
+
+#define INSNS_PER_FRAME 20  // 1200 Hz at 60 frames per second
+#define KEY_NONE 16
+
+static double now_sec() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Key held by lane during frame; changes every period frames, often none.
+static uint8_t input_key(int lane, int frame, int period) {
+  uint32_t h = (uint32_t)lane * 0x9E3779B1u ^ (uint32_t)(frame / period) * 0x85EBCA77u;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  h %= 32;
+  return h < KEY_NONE ? (uint8_t)h : KEY_NONE;
+}
+
+static void set_keys(Chip8* chip, uint8_t key) {
+  for (uint8_t k = 0; k < KEY_SIZE; k++) {
+    chip8_key_up(chip, k);
+  }
+  if (key != KEY_NONE) chip8_key_down(chip, key);
+}
+
+// Stack slots above SP are dead and not kept in sync by the batch.
+static bool same_state(const Chip8* a, const Chip8* b) {
+  return memcmp(a->V, b->V, sizeof(a->V)) == 0 && a->I == b->I && a->PC == b->PC && a->SP == b->SP &&
+         memcmp(a->stack, b->stack, a->SP * sizeof(a->stack[0])) == 0 && a->delay_timer == b->delay_timer &&
+         a->sound_timer == b->sound_timer && a->rng == b->rng && a->fault == b->fault &&
+         memcmp(a->memory, b->memory, sizeof(a->memory)) == 0 &&
+         memcmp(a->screen, b->screen, sizeof(a->screen)) == 0;
+}
+
+// Scalar reference: one Chip8 per lane, seeded like a batch with NULL seeds.
+static Chip8* load_machines(const char* rom, int lanes) {
+  Chip8* machines = malloc(lanes * sizeof(Chip8));
+  if (machines == NULL) {
+    fprintf(stderr, "Unable to allocate %d machines\n", lanes);
+    return NULL;
+  }
+  chip8_init(&machines[0]);
+  if (!chip8_load_rom(&machines[0], rom)) {
+    free(machines);
+    return NULL;
+  }
+  for (int l = 0; l < lanes; l++) {
+    if (l > 0) machines[l] = machines[0];
+    chip8_seed(&machines[l], (uint32_t)l + 1);
+  }
+  return machines;
+}
+
+static void free_machines(Chip8* machines) {
+  chip8_free(&machines[0]);  // the others share its code
+  free(machines);
+}
+
+static void run_scalar_frame(Chip8* machines, int lanes, int frame, int period) {
+  for (int l = 0; l < lanes; l++) {
+    Chip8* chip = &machines[l];
+    set_keys(chip, input_key(l, frame, period));
+    for (int n = 0; n < INSNS_PER_FRAME;) {
+      n += chip8_execute(chip);
+    }
+    chip8_tick(chip);
+  }
+}
+
+static void run_batch_frame(Chip8Batch* batch, int frame, int period) {
+  for (int l = 0; l < batch->lanes; l++) {
+    set_keys(&batch->machines[l], input_key(l, frame, period));
+  }
+  chip8_batch_run_frame(batch, INSNS_PER_FRAME);
+}
+
+static int count_mismatched(Chip8* machines, Chip8Batch* batch) {
+  int mismatched = 0;
+  for (int l = 0; l < batch->lanes; l++) {
+    if (!same_state(&machines[l], chip8_batch_lane(batch, l))) mismatched++;
+  }
+  return mismatched;
+}
+
+// Times both and compares the end states. Returns 1 on a mismatch, 42 if
+// the rom can't be loaded.
+static int bench(const char* rom, int lanes, int frames, int period, bool plain) {
+  Chip8* machines = load_machines(rom, lanes);
+  if (machines == NULL) return 42;
+
+  double start = now_sec();
+  for (int f = 0; f < frames; f++) {
+    run_scalar_frame(machines, lanes, f, period);
+  }
+  double scalar_sec = now_sec() - start;
+
+  static Chip8Batch batch;
+  if (!chip8_batch_init(&batch, lanes, rom, NULL)) return 1;
+  if (plain) batch.kernels = false;  // -s: without the AVX2 kernels
+
+  start = now_sec();
+  for (int f = 0; f < frames; f++) {
+    run_batch_frame(&batch, f, period);
+  }
+  double batch_sec = now_sec() - start;
+
+  int mismatched = count_mismatched(machines, &batch);
+
+  uint64_t total = batch.vector_insns + batch.scalar_insns;
+  double lane_frames = (double)lanes * frames;
+  printf("%d lanes x %d frames, %d instructions per frame, %s\n", lanes, frames, INSNS_PER_FRAME,
+         batch.kernels ? "AVX2" : "plain");
+  printf("scalar: %10.0f lane-frames/s (%.3f s)\n", lane_frames / scalar_sec, scalar_sec);
+  printf("batch:  %10.0f lane-frames/s (%.3f s), %.2fx\n", lane_frames / batch_sec, batch_sec,
+         scalar_sec / batch_sec);
+  printf("lane-parallel: %.1f%% of instructions\n", total ? 100.0 * batch.vector_insns / total : 0.0);
+  if (mismatched > 0) {
+    printf("MISMATCH: %d lanes differ from the scalar core\n", mismatched);
+  }
+
+  chip8_batch_free(&batch);
+  free_machines(machines);
+  return mismatched > 0;
+}
+
+// -c: the same comparison after every frame, so a lane that is right in the
+// end but a frame early or late along the way is caught too.
+static int check(const char* rom, int lanes, int frames, int period, bool plain) {
+  Chip8* machines = load_machines(rom, lanes);
+  if (machines == NULL) return 42;
+  static Chip8Batch batch;
+  if (!chip8_batch_init(&batch, lanes, rom, NULL)) return 1;
+  if (plain) batch.kernels = false;
+
+  int result = 0;
+  for (int f = 0; f < frames && result == 0; f++) {
+    run_scalar_frame(machines, lanes, f, period);
+    run_batch_frame(&batch, f, period);
+    int mismatched = count_mismatched(machines, &batch);
+    if (mismatched > 0) {
+      printf("MISMATCH: %s: %d lanes differ after frame %d\n", rom, mismatched, f + 1);
+      result = 1;
+    }
+  }
+  if (result == 0) printf("ok: %s\n", rom);
+
+  chip8_batch_free(&batch);
+  free_machines(machines);
+  return result;
+}
+
+int main(int argc, char** argv) {
+  int lanes = 1024;
+  int frames = 600;
+  int period = 30;
+  bool plain = false;
+  bool checking = false;
+  int first_arg = argc;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      lanes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+      period = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      plain = true;
+    } else if (strcmp(argv[i], "-c") == 0) {
+      checking = true;
+    } else {
+      first_arg = i;
+      break;
+    }
+  }
+
+  if (first_arg == argc || (!checking && argc - first_arg != 1) || lanes < 1 || frames < 1 || period < 1) {
+    fprintf(stderr,
+            "Usage: %s [-n lanes] [-f frames] [-k frames-per-key] [-s] <path/to/rom>\n"
+            "       %s -c [-n lanes] [-f frames] [-k frames-per-key] [-s] <path/to/rom>...\n",
+            argv[0], argv[0]);
+    return 42;
+  }
+
+  if (!checking) return bench(argv[first_arg], lanes, frames, period, plain);
+
+  int result = 0;
+  for (int i = first_arg; i < argc; i++) {
+    int r = check(argv[i], lanes, frames, period, plain);
+    if (r > result) result = r;
+  }
+  return result;
+}
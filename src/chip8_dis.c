@@ -0,0 +1,436 @@
+// src/chip8_dis.c
+// Offline disassembler: listing, basic blocks, call graph or DOT for a ROM,
+// or opcode n-gram counts across many ROMs, either over static code or over
+// what actually runs in a headless profile.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfg.h"
+#include "chip8.h"
+#include "decode.h"
+#include "disasm.h"
+
+#define ROM_START 0x200
+#define DATA_BYTES_PER_LINE 8
+#define NGRAM_TOP 20
+#define PROFILE_INSNS_PER_FRAME 20  // 1200 Hz, as the emulator runs
+#define PROFILE_KEY_FRAMES 30       // profiled key presses change twice a second
+
+typedef enum {
+  MODE_LISTING,
+  MODE_BLOCKS,
+  MODE_CALLS,
+  MODE_DOT,
+  MODE_NGRAMS,
+  MODE_PROFILE,
+} OutputMode;
+
+static uint8_t memory[MEM_SIZE];
+static Chip8Cfg cfg;
+
+// n-gram counts over straight-line code or executed instructions, indexed by
+// Chip8Op
+static unsigned pair_counts[OP_COUNT][OP_COUNT];
+static unsigned triple_counts[OP_COUNT][OP_COUNT][OP_COUNT];
+static unsigned fuse_counts[FUSE_COUNT];
+
+static Chip8Insn insn_at(uint16_t addr) {
+  return chip8_decode((uint16_t)(memory[addr] << 8) | memory[addr + 1]);
+}
+
+static void print_label(FILE* out, uint16_t addr) {
+  uint8_t f = cfg.flags[addr];
+  if (f & CFG_ENTRY) {
+    fprintf(out, "sub_%03X:\n", addr);
+  } else if (f & CFG_LEADER) {
+    fprintf(out, "L_%03X:\n", addr);
+  } else if (f & CFG_SPRITE) {
+    fprintf(out, "spr_%03X:\n", addr);
+  }
+}
+
+static void print_listing(FILE* out) {
+  char text[32];
+  uint16_t addr = cfg.start;
+
+  while (addr < cfg.end) {
+    print_label(out, addr);
+
+    if (cfg.flags[addr] & CFG_INSN) {
+      Chip8Insn insn = insn_at(addr);
+      chip8_disasm(&insn, text, sizeof(text));
+      fprintf(out, "  %03X: %04X  %s\n", addr, insn.opcode, text);
+      addr += 2;
+      continue;
+    }
+
+    // run of data bytes up to the next label or instruction
+    fprintf(out, "  %03X: .byte", addr);
+    int count = 0;
+    do {
+      fprintf(out, "%s0x%02X", count ? ", " : " ", memory[addr]);
+      addr++;
+      count++;
+    } while (addr < cfg.end && count < DATA_BYTES_PER_LINE && cfg.flags[addr] == 0);
+    fprintf(out, "\n");
+  }
+}
+
+static void print_blocks(FILE* out) {
+  for (uint16_t addr = cfg.start; addr < cfg.end; addr++) {
+    if (!(cfg.flags[addr] & CFG_LEADER) || !(cfg.flags[addr] & CFG_INSN)) continue;
+
+    uint16_t last = chip8_cfg_block_last(&cfg, memory, addr);
+    uint16_t succ[2];
+    int n = chip8_cfg_successors(&cfg, memory, last, succ);
+
+    fprintf(out, "block %03X-%03X (%d insns) ->", addr, last + 1, (last - addr) / 2 + 1);
+    for (int i = 0; i < n; i++) {
+      fprintf(out, " %03X", succ[i]);
+    }
+    if (cfg.flags[last] & CFG_INDIRECT) fprintf(out, " ?");
+    fprintf(out, "\n");
+  }
+}
+
+// Walks the body of the subroutine at entry and reports each callee once.
+// Jumps into another subroutine entry are reported as tail calls.
+static int collect_callees(uint16_t entry, uint16_t* callees, int max) {
+  static bool seen[MEM_SIZE];
+  static bool listed[MEM_SIZE];
+  static uint16_t stack[MEM_SIZE];
+  int top = 0;
+  int count = 0;
+
+  memset(seen, 0, sizeof(seen));
+  memset(listed, 0, sizeof(listed));
+  stack[top++] = entry;
+  seen[entry] = true;
+
+  while (top > 0) {
+    uint16_t addr = stack[--top];
+    Chip8Insn insn = insn_at(addr);
+
+    if (insn.op == OP_CALL && insn.nnn < MEM_SIZE && !listed[insn.nnn] && count < max) {
+      listed[insn.nnn] = true;
+      callees[count++] = insn.nnn;
+    }
+
+    uint16_t succ[2];
+    int n = chip8_cfg_successors(&cfg, memory, addr, succ);
+    for (int i = 0; i < n; i++) {
+      uint16_t s = succ[i];
+      if (seen[s]) continue;
+      seen[s] = true;
+
+      if ((cfg.flags[s] & CFG_ENTRY) && s != entry) {
+        if (!listed[s] && count < max) {
+          listed[s] = true;
+          callees[count++] = s;
+        }
+        continue;
+      }
+      stack[top++] = s;
+    }
+  }
+
+  return count;
+}
+
+static void print_calls(FILE* out) {
+  static uint16_t callees[MEM_SIZE];
+
+  for (uint16_t addr = cfg.start; addr < cfg.end; addr++) {
+    if (!(cfg.flags[addr] & CFG_ENTRY)) continue;
+
+    int n = collect_callees(addr, callees, MEM_SIZE);
+    fprintf(out, "sub_%03X ->", addr);
+    for (int i = 0; i < n; i++) {
+      fprintf(out, " sub_%03X", callees[i]);
+    }
+    fprintf(out, "\n");
+  }
+}
+
+static void print_dot(FILE* out) {
+  char text[32];
+
+  fprintf(out, "digraph chip8 {\n");
+  fprintf(out, "  node [shape=box, fontname=\"monospace\"];\n");
+
+  for (uint16_t addr = cfg.start; addr < cfg.end; addr++) {
+    if (!(cfg.flags[addr] & CFG_LEADER) || !(cfg.flags[addr] & CFG_INSN)) continue;
+
+    uint16_t last = chip8_cfg_block_last(&cfg, memory, addr);
+
+    fprintf(out, "  b_%03X [label=\"", addr);
+    if (cfg.flags[addr] & CFG_ENTRY) fprintf(out, "sub_%03X\\l", addr);
+    for (uint16_t a = addr; a <= last; a += 2) {
+      Chip8Insn insn = insn_at(a);
+      chip8_disasm(&insn, text, sizeof(text));
+      fprintf(out, "%03X: %s\\l", a, text);
+    }
+    fprintf(out, "\"];\n");
+
+    uint16_t succ[2];
+    int n = chip8_cfg_successors(&cfg, memory, last, succ);
+    for (int i = 0; i < n; i++) {
+      fprintf(out, "  b_%03X -> b_%03X;\n", addr, succ[i]);
+    }
+
+    Chip8Insn insn = insn_at(last);
+    if (insn.op == OP_CALL && (cfg.flags[insn.nnn] & CFG_ENTRY)) {
+      fprintf(out, "  b_%03X -> b_%03X [style=dashed];\n", addr, insn.nnn);
+    }
+  }
+
+  fprintf(out, "}\n");
+}
+
+// Next instruction when it always runs right after addr, or false where
+// control may go elsewhere: jumps, returns, calls (the callee runs in
+// between) and skips.
+static bool next_insn(uint16_t addr, Chip8Insn* out) {
+  Chip8Insn insn = insn_at(addr);
+  uint32_t next = addr + 2u;
+  if (chip8_insn_is_terminator(&insn) || insn.op == OP_CALL || chip8_insn_is_skip(&insn) ||
+      next + 1 >= cfg.end || !(cfg.flags[next] & CFG_INSN)) {
+    return false;
+  }
+  *out = insn_at((uint16_t)next);
+  return true;
+}
+
+static void count_ngrams() {
+  for (uint16_t addr = cfg.start; addr < cfg.end; addr++) {
+    if (!(cfg.flags[addr] & CFG_INSN)) continue;
+
+    // the interpreter fuses on the raw bytes that follow, like decode_at()
+    Chip8Insn a = insn_at(addr);
+    if (addr + 5u < MEM_SIZE) {
+      Chip8Insn next = insn_at(addr + 2);
+      Chip8Insn after = insn_at(addr + 4);
+      fuse_counts[chip8_fuse(&a, &next, &after, addr)]++;
+    }
+
+    Chip8Insn b, c;
+    if (!next_insn(addr, &b)) continue;
+    pair_counts[a.op][b.op]++;
+    if (next_insn(addr + 2, &c)) triple_counts[a.op][b.op][c.op]++;
+  }
+}
+
+// The instruction at addr in the machine's memory as it is now.
+static Chip8Insn insn_in(const Chip8* chip, unsigned addr) {
+  return chip8_decode((uint16_t)(chip->memory[addr] << 8) | chip->memory[addr + 1]);
+}
+
+// Key held during frame, or KEY_SIZE for none; fixed so profiles repeat.
+static uint8_t profile_key(int frame) {
+  uint32_t h = (uint32_t)(frame / PROFILE_KEY_FRAMES + 1) * 0x9E3779B1u;
+  h ^= h >> 15;
+  return h % (KEY_SIZE * 2) < KEY_SIZE ? h % KEY_SIZE : KEY_SIZE;
+}
+
+// Runs the rom headless for frames frames and counts the instructions as
+// they execute, so pairs span calls and taken branches the way they run.
+// Fused sequences are straight-line, so an execute that retires k
+// instructions ran the k at PC, PC + 2, ... in order.
+static bool profile_ngrams(const char* romPath, int frames) {
+  static Chip8 chip;
+  chip8_init(&chip);
+  if (!chip8_load_rom(&chip, romPath)) return false;
+  chip8_seed(&chip, 1);
+
+  int prev2 = -1;
+  int prev1 = -1;
+  for (int f = 0; f < frames && chip.fault == CHIP8_FAULT_NONE; f++) {
+    uint8_t key = profile_key(f);
+    for (uint8_t k = 0; k < KEY_SIZE; k++) {
+      chip.keys[k] = k == key;
+    }
+
+    for (int n = 0; n < PROFILE_INSNS_PER_FRAME;) {
+      uint16_t pc = chip.PC;
+      int retired = chip8_execute(&chip);
+      if (chip.fault != CHIP8_FAULT_NONE) break;
+      if (retired > 1) {
+        // fused sequences never write memory, so it still holds what ran
+        Chip8Insn a = insn_in(&chip, pc);
+        Chip8Insn b = insn_in(&chip, pc + 2);
+        Chip8Insn c = insn_in(&chip, pc + 4);
+        fuse_counts[chip8_fuse(&a, &b, &c, pc)]++;
+      }
+
+      for (int i = 0; i < retired; i++) {
+        uint16_t addr = pc + 2 * i;
+        int op = insn_in(&chip, addr).op;
+        if (prev1 >= 0) pair_counts[prev1][op]++;
+        if (prev2 >= 0) triple_counts[prev2][prev1][op]++;
+        prev2 = prev1;
+        prev1 = op;
+      }
+      n += retired;
+    }
+    chip8_tick(&chip);
+  }
+
+  if (chip.fault != CHIP8_FAULT_NONE) {
+    fprintf(stderr, "%s: %s at 0x%03X, profile cut short\n", romPath, chip8_fault_name(chip.fault), chip.PC);
+  }
+  chip8_free(&chip);
+  return true;
+}
+
+typedef struct {
+  unsigned count;
+  uint8_t ops[3];
+} Ngram;
+
+static int compare_ngrams(const void* lhs, const void* rhs) {
+  const Ngram* a = lhs;
+  const Ngram* b = rhs;
+  return (a->count < b->count) - (a->count > b->count);
+}
+
+static void print_top(FILE* out, Ngram* grams, size_t n, int len) {
+  qsort(grams, n, sizeof(Ngram), compare_ngrams);
+  for (size_t i = 0; i < n && i < NGRAM_TOP && grams[i].count > 0; i++) {
+    fprintf(out, "  %6u ", grams[i].count);
+    for (int k = 0; k < len; k++) {
+      fprintf(out, " %s", chip8_op_pattern(grams[i].ops[k]));
+    }
+    fprintf(out, "\n");
+  }
+}
+
+static void print_ngrams(FILE* out, int roms, int frames) {
+  static Ngram grams[OP_COUNT * OP_COUNT * OP_COUNT];
+  static const char* fuse_names[FUSE_COUNT] = {
+      [FUSE_NONE] = "none",
+      [FUSE_ADD_SKIP] = "7XNN 3XNN/4XNN",
+      [FUSE_ADDI_LOAD] = "FX1E FX65",
+      [FUSE_SPRITE_SETUP] = "6XNN 6YNN DXYN",
+      [FUSE_DELAY_WAIT] = "FX07 3X00 1NNN",
+  };
+  size_t n = 0;
+
+  for (int a = 0; a < OP_COUNT; a++) {
+    for (int b = 0; b < OP_COUNT; b++) {
+      grams[n++] = (Ngram){pair_counts[a][b], {a, b, 0}};
+    }
+  }
+  if (frames > 0) {
+    fprintf(out, "pairs (executed over %d frames of %d roms):\n", frames, roms);
+  } else {
+    fprintf(out, "pairs (static sites in %d roms):\n", roms);
+  }
+  print_top(out, grams, n, 2);
+
+  n = 0;
+  for (int a = 0; a < OP_COUNT; a++) {
+    for (int b = 0; b < OP_COUNT; b++) {
+      for (int c = 0; c < OP_COUNT; c++) {
+        grams[n++] = (Ngram){triple_counts[a][b][c], {a, b, c}};
+      }
+    }
+  }
+  fprintf(out, "triples:\n");
+  print_top(out, grams, n, 3);
+
+  fprintf(out, frames > 0 ? "fused by the interpreter (executions):\n" : "fused by the interpreter (sites):\n");
+  for (int f = FUSE_NONE + 1; f < FUSE_COUNT; f++) {
+    fprintf(out, "  %6u  %s\n", fuse_counts[f], fuse_names[f]);
+  }
+}
+
+static bool load_rom(const char* romPath) {
+  FILE* rom = fopen(romPath, "rb");
+  if (rom == NULL) {
+    fprintf(stderr, "Unable to open rom file: %s\n", romPath);
+    return false;
+  }
+  memset(memory, 0, sizeof(memory));
+  size_t rom_size = fread(&memory[ROM_START], 1, MAX_ROM_SIZE, rom);
+  fclose(rom);
+
+  chip8_cfg_analyze(memory, ROM_START, (uint16_t)(ROM_START + rom_size), &cfg);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  OutputMode mode = MODE_LISTING;
+  int frames = 0;
+  int first_rom = argc;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-b") == 0) {
+      mode = MODE_BLOCKS;
+    } else if (strcmp(argv[i], "-c") == 0) {
+      mode = MODE_CALLS;
+    } else if (strcmp(argv[i], "-d") == 0) {
+      mode = MODE_DOT;
+    } else if (strcmp(argv[i], "-n") == 0) {
+      mode = MODE_NGRAMS;
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      mode = MODE_PROFILE;
+      frames = atoi(argv[++i]);
+    } else {
+      first_rom = i;
+      break;
+    }
+  }
+
+  int roms = argc - first_rom;
+  bool many = mode == MODE_NGRAMS || mode == MODE_PROFILE;
+  if (roms == 0 || (!many && roms != 1) || (mode == MODE_PROFILE && frames < 1)) {
+    fprintf(stderr, "Usage: %s [-b | -c | -d] <path/to/rom>\n", argv[0]);
+    fprintf(stderr, "       %s -n | -p frames <path/to/rom>...\n", argv[0]);
+    fprintf(stderr, "  -b  basic blocks\n  -c  call graph\n  -d  control-flow graph as DOT\n");
+    fprintf(stderr, "  -n  opcode pair/triple counts over static code in all given roms\n");
+    fprintf(stderr, "  -p  the same, counted while running each rom headless for frames frames\n");
+    return 42;
+  }
+
+  if (mode == MODE_NGRAMS) {
+    for (int i = first_rom; i < argc; i++) {
+      if (load_rom(argv[i])) count_ngrams();
+    }
+    print_ngrams(stdout, roms, 0);
+    return 0;
+  }
+  if (mode == MODE_PROFILE) {
+    for (int i = first_rom; i < argc; i++) {
+      profile_ngrams(argv[i], frames);
+    }
+    print_ngrams(stdout, roms, frames);
+    return 0;
+  }
+
+  if (!load_rom(argv[first_rom])) {
+    return 42;
+  }
+
+  switch (mode) {
+    case MODE_LISTING:
+      print_listing(stdout);
+      break;
+    case MODE_BLOCKS:
+      print_blocks(stdout);
+      break;
+    case MODE_CALLS:
+      print_calls(stdout);
+      break;
+    case MODE_DOT:
+      print_dot(stdout);
+      break;
+    case MODE_NGRAMS:
+    case MODE_PROFILE:
+      break;
+  }
+
+  return 0;
+}
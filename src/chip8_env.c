@@ -0,0 +1,158 @@
+// src/chip8_env.c
+// Drives a Chip8Env with random actions and reports environment steps per
+// second, optionally publishing to shared memory; --show reads one
+// environment's screen from that segment in another process.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "env.h"
+
+static double now_sec() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "Usage: %s [-n envs] [-k frames-per-step] [-s steps] [-r mem:ADDR|reg:X] [--shm name] <path/to/rom>\n"
+          "       %s --show name [-e env]\n",
+          prog, prog);
+  exit(42);
+}
+
+static int show(const char* name, int index) {
+  const Chip8EnvHeader* header = chip8_env_attach(name);
+  if (header == NULL) return 1;
+  if (index < 0 || (uint32_t)index >= header->envs) {
+    fprintf(stderr, "No environment %d (of %u)\n", index, header->envs);
+    chip8_env_detach(header);
+    return 1;
+  }
+
+  // a consistent copy of the env, retried while the writer is mid step
+  uint8_t bits[CHIP8_ENV_OBS_BYTES];
+  float reward;
+  uint8_t done;
+  uint64_t before, after;
+  do {
+    before = __atomic_load_n(&header->steps, __ATOMIC_ACQUIRE);
+    memcpy(bits, chip8_env_obs_of(header, index), sizeof(bits));
+    memcpy(&reward, (const uint8_t*)header + header->reward_offset + (uint64_t)index * sizeof(float),
+           sizeof(reward));
+    done = ((const uint8_t*)header + header->done_offset)[index];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = __atomic_load_n(&header->steps, __ATOMIC_RELAXED);
+  } while ((before & 1) != 0 || before != after);
+
+  printf("%s: %u envs, step %llu, env %d reward %g%s\n", name, header->envs, (unsigned long long)(before / 2),
+         index, reward, done ? " (done)" : "");
+  for (int y = 0; y < SCREEN_H; y++) {
+    for (int x = 0; x < SCREEN_W; x++) {
+      int i = SCREEN_IDX(y, x);
+      putchar((bits[i >> 3] >> (7 - (i & 7))) & 1 ? '#' : '.');
+    }
+    putchar('\n');
+  }
+  chip8_env_detach(header);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int envs = 256;
+  int frames = 4;
+  int steps = 1000;
+  const char* shm = NULL;
+  const char* shown = NULL;
+  int shown_env = 0;
+  Chip8RewardSource reward_source = CHIP8_REWARD_NONE;
+  int reward_index = 0;
+  int first_arg = argc;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      envs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      steps = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      shown_env = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+      shm = argv[++i];
+    } else if (strcmp(argv[i], "--show") == 0 && i + 1 < argc) {
+      shown = argv[++i];
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      const char* spec = argv[++i];
+      if (strncmp(spec, "mem:", 4) == 0) {
+        reward_source = CHIP8_REWARD_MEMORY;
+      } else if (strncmp(spec, "reg:", 4) == 0) {
+        reward_source = CHIP8_REWARD_REGISTER;
+      } else {
+        usage(argv[0]);
+      }
+      reward_index = (int)strtol(spec + 4, NULL, 16);
+    } else {
+      first_arg = i;
+      break;
+    }
+  }
+
+  if (shown != NULL) {
+    if (first_arg != argc) usage(argv[0]);
+    return show(shown, shown_env);
+  }
+  if (argc - first_arg != 1 || envs < 1 || frames < 1 || steps < 1) usage(argv[0]);
+
+  static Chip8Env env;
+  if (!chip8_env_init(&env, envs, argv[first_arg], shm)) return 1;
+  if (!chip8_env_set_reward(&env, reward_source, reward_index)) {
+    chip8_env_free(&env);
+    return 1;
+  }
+  chip8_env_reset(&env, NULL);
+
+  uint8_t* actions = malloc(envs);
+  if (actions == NULL) {
+    fprintf(stderr, "Unable to allocate %d actions\n", envs);
+    return 1;
+  }
+  uint32_t rng = 0x2545F491;
+  double reward_sum = 0.0;
+  int resets = 0;
+
+  double start = now_sec();
+  for (int s = 0; s < steps; s++) {
+    for (int e = 0; e < envs; e++) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      actions[e] = rng % (CHIP8_ENV_NO_KEY + 1);
+    }
+    chip8_env_step(&env, actions, frames);
+    for (int e = 0; e < envs; e++) {
+      reward_sum += env.reward[e];
+      if (env.done[e]) {
+        chip8_env_reset_one(&env, e, rng + e);
+        resets++;
+      }
+    }
+  }
+  double sec = now_sec() - start;
+
+  printf("%d envs x %d steps of %d frames in %.3f s\n", envs, steps, frames, sec);
+  printf("%.0f env-steps/s, %.0f frames/s\n", (double)envs * steps / sec, (double)envs * steps * frames / sec);
+  printf("reward %g, %d resets\n", reward_sum, resets);
+  if (shm != NULL) {
+    printf("%s holds the last step; press enter to remove it\n", shm);
+    getchar();
+  }
+
+  free(actions);
+  chip8_env_free(&env);
+  return 0;
+}
@@ -0,0 +1,434 @@
+// src/chip8_rec.c
+// Offline player for frame logs written by chip8 --record: prints info,
+// shows a frame as text, or exports PNG sequences and animated GIFs.
+// Both image writers are self-contained (stored deflate, plain LZW).
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framelog.h"
+#include "frontend.h"
+
+#define GIF_FRAME_USEC 20000  // 50 fps, the finest delay viewers honour
+#define STORED_BLOCK_MAX 65535
+
+typedef struct {
+  int scale;
+  uint64_t from;  // usec
+  uint64_t to;    // usec, inclusive
+} ExportRange;
+
+static FramelogReader reader;
+static uint8_t* frame = NULL;   // FRAME_* bytes of the current frame
+static uint8_t* pixels = NULL;  // scaled 8-bit gray
+static int out_w = 0;
+static int out_h = 0;
+
+static void scale_frame(int scale) {
+  for (int y = 0; y < out_h; y++) {
+    const uint8_t* src = &frame[(y / scale) * reader.width];
+    for (int x = 0; x < out_w; x++) {
+      pixels[y * out_w + x] = src[x / scale] == FRAME_ON;
+    }
+  }
+}
+
+// --- PNG ---
+
+static uint32_t crc_table[256];
+
+static void crc_init() {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    crc_table[n] = c;
+  }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+static void put_be32(uint8_t* p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static void png_chunk(FILE* f, const char* type, const uint8_t* data, uint32_t len) {
+  uint8_t word[4];
+  put_be32(word, len);
+  fwrite(word, 1, 4, f);
+  fwrite(type, 1, 4, f);
+  fwrite(data, 1, len, f);
+
+  uint32_t crc = crc_update(0xFFFFFFFFu, (const uint8_t*)type, 4);
+  crc = crc_update(crc, data, len) ^ 0xFFFFFFFFu;
+  put_be32(word, crc);
+  fwrite(word, 1, 4, f);
+}
+
+// 8-bit grayscale PNG; the zlib stream uses stored blocks only.
+static bool write_png(const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "Unable to create %s\n", path);
+    return false;
+  }
+
+  size_t row = (size_t)out_w + 1;
+  size_t raw_len = row * out_h;
+  size_t blocks = (raw_len + STORED_BLOCK_MAX - 1) / STORED_BLOCK_MAX;
+  size_t idat_len = 2 + raw_len + blocks * 5 + 4;
+  uint8_t* idat = malloc(idat_len);
+  uint8_t* raw = malloc(raw_len);
+  if (idat == NULL || raw == NULL) {
+    fprintf(stderr, "Unable to allocate PNG buffers\n");
+    exit(1);
+  }
+
+  for (int y = 0; y < out_h; y++) {
+    raw[y * row] = 0;  // filter: none
+    for (int x = 0; x < out_w; x++) raw[y * row + 1 + x] = pixels[y * out_w + x] ? 0xFF : 0x00;
+  }
+
+  size_t n = 0;
+  uint32_t a = 1, b = 0;  // adler32
+  idat[n++] = 0x78;
+  idat[n++] = 0x01;
+  for (size_t pos = 0; pos < raw_len; pos += STORED_BLOCK_MAX) {
+    size_t len = raw_len - pos < STORED_BLOCK_MAX ? raw_len - pos : STORED_BLOCK_MAX;
+    idat[n++] = pos + len == raw_len;  // BFINAL, BTYPE=00
+    idat[n++] = len & 0xFF;
+    idat[n++] = len >> 8;
+    idat[n++] = ~len & 0xFF;
+    idat[n++] = (~len >> 8) & 0xFF;
+    memcpy(&idat[n], &raw[pos], len);
+    n += len;
+    for (size_t i = 0; i < len; i++) {
+      a = (a + raw[pos + i]) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+  put_be32(&idat[n], b << 16 | a);
+  n += 4;
+
+  uint8_t ihdr[13];
+  put_be32(&ihdr[0], out_w);
+  put_be32(&ihdr[4], out_h);
+  ihdr[8] = 8;   // bit depth
+  ihdr[9] = 0;   // grayscale
+  ihdr[10] = 0;  // deflate
+  ihdr[11] = 0;  // adaptive filtering
+  ihdr[12] = 0;  // no interlace
+
+  fwrite("\x89PNG\r\n\x1a\n", 1, 8, f);
+  png_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+  png_chunk(f, "IDAT", idat, (uint32_t)n);
+  png_chunk(f, "IEND", NULL, 0);
+
+  free(idat);
+  free(raw);
+  return fclose(f) == 0;
+}
+
+// --- GIF ---
+
+// GIF LZW with a 2 color alphabet: the string table is a binary trie.
+#define GIF_MIN_BITS 2
+#define GIF_CLEAR (1 << GIF_MIN_BITS)
+#define GIF_END (GIF_CLEAR + 1)
+#define GIF_MAX_CODES 4096
+
+typedef struct {
+  FILE* f;
+  uint8_t block[255];
+  int block_len;
+  uint32_t acc;
+  int acc_bits;
+  int bits;  // current code width
+} GifBits;
+
+static void gif_put_code(GifBits* g, uint32_t code) {
+  g->acc |= code << g->acc_bits;
+  g->acc_bits += g->bits;
+  while (g->acc_bits >= 8) {
+    g->block[g->block_len++] = g->acc & 0xFF;
+    g->acc >>= 8;
+    g->acc_bits -= 8;
+    if (g->block_len == 255) {
+      fputc(255, g->f);
+      fwrite(g->block, 1, 255, g->f);
+      g->block_len = 0;
+    }
+  }
+}
+
+static void gif_flush(GifBits* g) {
+  if (g->acc_bits > 0) {
+    g->block[g->block_len++] = g->acc & 0xFF;
+    g->acc = 0;
+    g->acc_bits = 0;
+  }
+  if (g->block_len > 0) {
+    fputc(g->block_len, g->f);
+    fwrite(g->block, 1, g->block_len, g->f);
+    g->block_len = 0;
+  }
+  fputc(0, g->f);  // block terminator
+}
+
+static void gif_put_u16(FILE* f, uint16_t v) {
+  fputc(v & 0xFF, f);
+  fputc(v >> 8, f);
+}
+
+static void gif_header(FILE* f) {
+  fwrite("GIF89a", 1, 6, f);
+  gif_put_u16(f, (uint16_t)out_w);
+  gif_put_u16(f, (uint16_t)out_h);
+  fputc(0x80, f);  // global color table of 2 entries
+  fputc(0, f);     // background color
+  fputc(0, f);     // aspect ratio
+  fwrite("\x00\x00\x00\xFF\xFF\xFF", 1, 6, f);
+
+  // loop forever
+  fwrite("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, f);
+}
+
+static void gif_frame(FILE* f, const uint8_t* image, uint16_t delay_cs) {
+  fwrite("\x21\xF9\x04\x00", 1, 4, f);
+  gif_put_u16(f, delay_cs);
+  fputc(0, f);  // transparent color index (unused)
+  fputc(0, f);
+
+  fputc(0x2C, f);
+  gif_put_u16(f, 0);
+  gif_put_u16(f, 0);
+  gif_put_u16(f, (uint16_t)out_w);
+  gif_put_u16(f, (uint16_t)out_h);
+  fputc(0, f);  // no local color table
+
+  static uint16_t child[GIF_MAX_CODES][2];
+  GifBits g = {.f = f, .bits = GIF_MIN_BITS + 1};
+  int next_code = GIF_END + 1;
+
+  memset(child, 0, sizeof(child));
+  fputc(GIF_MIN_BITS, f);
+  gif_put_code(&g, GIF_CLEAR);
+
+  size_t count = (size_t)out_w * out_h;
+  uint16_t cur = image[0];
+  for (size_t i = 1; i < count; i++) {
+    uint8_t p = image[i];
+    if (child[cur][p]) {
+      cur = child[cur][p];
+      continue;
+    }
+    gif_put_code(&g, cur);
+
+    child[cur][p] = (uint16_t)next_code++;
+    if (next_code > (1 << g.bits) && g.bits < 12) g.bits++;
+    // start over before the table overflows rather than freezing it
+    if (next_code == GIF_MAX_CODES - 1) {
+      gif_put_code(&g, GIF_CLEAR);
+      memset(child, 0, sizeof(child));
+      next_code = GIF_END + 1;
+      g.bits = GIF_MIN_BITS + 1;
+    }
+    cur = p;
+  }
+  gif_put_code(&g, cur);
+  // the decoder adds one more entry on reading cur
+  if (next_code >= (1 << g.bits) && g.bits < 12) g.bits++;
+  gif_put_code(&g, GIF_END);
+  gif_flush(&g);
+}
+
+// --- commands ---
+
+static void alloc_buffers(int scale) {
+  out_w = reader.width * scale;
+  out_h = reader.height * scale;
+  frame = malloc((size_t)reader.width * reader.height);
+  pixels = malloc((size_t)out_w * out_h);
+  if (frame == NULL || pixels == NULL) {
+    fprintf(stderr, "Unable to allocate frame buffers\n");
+    exit(1);
+  }
+}
+
+static bool load_frame(size_t index) {
+  if (!framelog_seek(&reader, index)) {
+    fprintf(stderr, "Corrupt frame %zu\n", index);
+    return false;
+  }
+  framelog_unpack(reader.bits, (size_t)reader.width * reader.height, frame);
+  return true;
+}
+
+static int cmd_info() {
+  size_t keyframes = 0;
+  for (size_t i = 0; i < reader.count; i++) keyframes += reader.types[i] == FRAMELOG_KEYFRAME;
+
+  uint64_t duration = reader.count ? reader.timestamps[reader.count - 1] - reader.timestamps[0] : 0;
+  printf("size:      %ux%u\n", reader.width, reader.height);
+  printf("frames:    %zu (%zu keyframes)\n", reader.count, keyframes);
+  printf("duration:  %.3f s\n", duration / 1e6);
+  return 0;
+}
+
+static int cmd_text(const ExportRange* range) {
+  size_t index = framelog_find(&reader, range->from);
+  if (!load_frame(index)) return 1;
+
+  printf("frame %zu at %.3f s\n", index, reader.timestamps[index] / 1e6);
+  for (int y = 0; y < reader.height; y++) {
+    for (int x = 0; x < reader.width; x++) {
+      putchar(frame[y * reader.width + x] == FRAME_ON ? '#' : '.');
+    }
+    putchar('\n');
+  }
+  return 0;
+}
+
+static int cmd_png(const ExportRange* range, const char* prefix) {
+  char path[1024];
+  size_t exported = 0;
+
+  for (size_t i = framelog_find(&reader, range->from); i < reader.count; i++) {
+    if (reader.timestamps[i] > range->to) break;
+    if (!load_frame(i)) return 1;
+
+    scale_frame(range->scale);
+    snprintf(path, sizeof(path), "%s_%05zu.png", prefix, exported++);
+    if (!write_png(path)) return 1;
+  }
+
+  printf("wrote %zu frames\n", exported);
+  return 0;
+}
+
+// Samples the log at a fixed rate and merges identical samples into one
+// longer GIF frame, so bursts of redraws neither bloat nor slow the GIF.
+static int cmd_gif(const ExportRange* range, const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "Unable to create %s\n", path);
+    return 1;
+  }
+  gif_header(f);
+
+  uint8_t* pending = malloc((size_t)out_w * out_h);
+  if (pending == NULL) {
+    fprintf(stderr, "Unable to allocate GIF buffer\n");
+    exit(1);
+  }
+  uint64_t end = range->to;
+  if (end > reader.timestamps[reader.count - 1]) end = reader.timestamps[reader.count - 1];
+
+  size_t frames = 0;
+  unsigned pending_cs = 0;
+  for (uint64_t t = range->from; t <= end; t += GIF_FRAME_USEC) {
+    if (!load_frame(framelog_find(&reader, t))) break;
+    scale_frame(range->scale);
+
+    if (pending_cs > 0 && memcmp(pending, pixels, (size_t)out_w * out_h) == 0 && pending_cs < 65000) {
+      pending_cs += GIF_FRAME_USEC / 10000;
+      continue;
+    }
+    if (pending_cs > 0) {
+      gif_frame(f, pending, (uint16_t)pending_cs);
+      frames++;
+    }
+    memcpy(pending, pixels, (size_t)out_w * out_h);
+    pending_cs = GIF_FRAME_USEC / 10000;
+  }
+  if (pending_cs > 0) {
+    gif_frame(f, pending, (uint16_t)pending_cs);
+    frames++;
+  }
+
+  fputc(0x3B, f);  // trailer
+  fclose(f);
+  free(pending);
+  printf("wrote %zu frames\n", frames);
+  return 0;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s info <log>\n", prog);
+  fprintf(stderr, "       %s text [-f sec] <log>\n", prog);
+  fprintf(stderr, "       %s png [-s scale] [-f sec] [-t sec] <log> <out-prefix>\n", prog);
+  fprintf(stderr, "       %s gif [-s scale] [-f sec] [-t sec] <log> <out.gif>\n", prog);
+  fprintf(stderr, "  -f, -t  export from / to this many seconds after the first frame\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    usage(argv[0]);
+    return 42;
+  }
+
+  const char* cmd = argv[1];
+  ExportRange range = {1, 0, UINT64_MAX};
+  double from = 0, to = -1;
+  int first_arg = argc;
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      range.scale = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      from = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      to = atof(argv[++i]);
+    } else {
+      first_arg = i;
+      break;
+    }
+  }
+
+  int args = argc - first_arg;
+  bool needs_out = strcmp(cmd, "png") == 0 || strcmp(cmd, "gif") == 0;
+  if (args != (needs_out ? 2 : 1) || range.scale < 1 || range.scale > 64) {
+    usage(argv[0]);
+    return 42;
+  }
+
+  if (!framelog_open(&reader, argv[first_arg])) {
+    return 42;
+  }
+  if (reader.count == 0) {
+    fprintf(stderr, "No frames in %s\n", argv[first_arg]);
+    framelog_close(&reader);
+    return 42;
+  }
+
+  uint64_t base = reader.timestamps[0];
+  range.from = base + (uint64_t)(from * 1e6);
+  if (to >= 0) range.to = base + (uint64_t)(to * 1e6);
+
+  alloc_buffers(range.scale);
+  crc_init();
+
+  int status;
+  if (strcmp(cmd, "info") == 0) {
+    status = cmd_info();
+  } else if (strcmp(cmd, "text") == 0) {
+    status = cmd_text(&range);
+  } else if (strcmp(cmd, "png") == 0) {
+    status = cmd_png(&range, argv[first_arg + 1]);
+  } else if (strcmp(cmd, "gif") == 0) {
+    status = cmd_gif(&range, argv[first_arg + 1]);
+  } else {
+    usage(argv[0]);
+    status = 42;
+  }
+
+  framelog_close(&reader);
+  return status;
+}
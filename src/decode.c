@@ -0,0 +1,154 @@
+#include "decode.h"
+
+#define X(op) ((op & 0x0F00) >> 8)
+#define Y(op) ((op & 0x00F0) >> 4)
+#define N(op) (op & 0x000F)
+#define NN(op) (op & 0x00FF)
+#define NNN(op) (op & 0x0FFF)
+
+static uint8_t decode_op(uint16_t opcode) {
+  switch ((opcode & 0xF000) >> 12) {
+    case 0x0:
+      switch (NN(opcode)) {
+        case 0xE0:
+          return OP_CLS;
+        case 0xEE:
+          return OP_RET;
+        default:
+          return OP_SYS;
+      }
+    case 0x1:
+      return OP_JP;
+    case 0x2:
+      return OP_CALL;
+    case 0x3:
+      return OP_SE_IMM;
+    case 0x4:
+      return OP_SNE_IMM;
+    case 0x5:
+      return OP_SE_REG;
+    case 0x6:
+      return OP_LD_IMM;
+    case 0x7:
+      return OP_ADD_IMM;
+    case 0x8:
+      switch (N(opcode)) {
+        case 0x0:
+          return OP_LD_REG;
+        case 0x1:
+          return OP_OR;
+        case 0x2:
+          return OP_AND;
+        case 0x3:
+          return OP_XOR;
+        case 0x4:
+          return OP_ADD_REG;
+        case 0x5:
+          return OP_SUB;
+        case 0x6:
+          return OP_SHR;
+        case 0x7:
+          return OP_SUBN;
+        case 0xE:
+          return OP_SHL;
+        default:
+          return OP_UNKNOWN;
+      }
+    case 0x9:
+      // Only valid if last nibble = 0
+      return N(opcode) == 0 ? OP_SNE_REG : OP_UNKNOWN;
+    case 0xA:
+      return OP_LD_I;
+    case 0xB:
+      return OP_JP_V;
+    case 0xC:
+      return OP_RND;
+    case 0xD:
+      return OP_DRW;
+    case 0xE:
+      switch (NN(opcode)) {
+        case 0x9E:
+          return OP_SKP;
+        case 0xA1:
+          return OP_SKNP;
+        default:
+          return OP_UNKNOWN;
+      }
+    case 0xF:
+      switch (NN(opcode)) {
+        case 0x07:
+          return OP_LD_VX_DT;
+        case 0x0A:
+          return OP_LD_VX_K;
+        case 0x15:
+          return OP_LD_DT;
+        case 0x18:
+          return OP_LD_ST;
+        case 0x1E:
+          return OP_ADD_I;
+        case 0x29:
+          return OP_LD_F;
+        case 0x33:
+          return OP_LD_B;
+        case 0x55:
+          return OP_LD_MEM;
+        case 0x65:
+          return OP_LD_REGS;
+        default:
+          return OP_UNKNOWN;
+      }
+  }
+  return OP_UNKNOWN;
+}
+
+Chip8Insn chip8_decode(uint16_t opcode) {
+  Chip8Insn insn;
+  insn.opcode = opcode;
+  insn.nnn = NNN(opcode);
+  insn.op = decode_op(opcode);
+  insn.fuse = FUSE_NONE;
+  insn.x = X(opcode);
+  insn.y = Y(opcode);
+  insn.n = N(opcode);
+  insn.nn = NN(opcode);
+  return insn;
+}
+
+uint8_t chip8_fuse(const Chip8Insn* a, const Chip8Insn* b, const Chip8Insn* c, uint16_t addr) {
+  switch (a->op) {
+    case OP_LD_VX_DT:
+      // FX07; 3X00; JP back to the FX07
+      if (b->op == OP_SE_IMM && b->x == a->x && b->nn == 0 && c->op == OP_JP && c->nnn == addr) {
+        return FUSE_DELAY_WAIT;
+      }
+      break;
+    case OP_ADD_IMM:
+      if (b->op == OP_SE_IMM || b->op == OP_SNE_IMM) return FUSE_ADD_SKIP;
+      break;
+    case OP_ADD_I:
+      if (b->op == OP_LD_REGS) return FUSE_ADDI_LOAD;
+      break;
+    case OP_LD_IMM:
+      if (b->op == OP_LD_IMM && c->op == OP_DRW) return FUSE_SPRITE_SETUP;
+      break;
+  }
+  return FUSE_NONE;
+}
+
+bool chip8_insn_is_terminator(const Chip8Insn* insn) {
+  return insn->op == OP_JP || insn->op == OP_JP_V || insn->op == OP_RET;
+}
+
+bool chip8_insn_is_skip(const Chip8Insn* insn) {
+  switch (insn->op) {
+    case OP_SE_IMM:
+    case OP_SNE_IMM:
+    case OP_SE_REG:
+    case OP_SNE_REG:
+    case OP_SKP:
+    case OP_SKNP:
+      return true;
+    default:
+      return false;
+  }
+}
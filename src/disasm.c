@@ -0,0 +1,100 @@
+#include "disasm.h"
+
+#include <stdio.h>
+
+static const char* op_patterns[OP_COUNT] = {
+    [OP_NONE] = "----",      [OP_UNKNOWN] = "????",   [OP_SYS] = "0NNN",      [OP_CLS] = "00E0",
+    [OP_RET] = "00EE",       [OP_JP] = "1NNN",        [OP_CALL] = "2NNN",     [OP_SE_IMM] = "3XNN",
+    [OP_SNE_IMM] = "4XNN",   [OP_SE_REG] = "5XY0",    [OP_LD_IMM] = "6XNN",   [OP_ADD_IMM] = "7XNN",
+    [OP_LD_REG] = "8XY0",    [OP_OR] = "8XY1",        [OP_AND] = "8XY2",      [OP_XOR] = "8XY3",
+    [OP_ADD_REG] = "8XY4",   [OP_SUB] = "8XY5",       [OP_SHR] = "8XY6",      [OP_SUBN] = "8XY7",
+    [OP_SHL] = "8XYE",       [OP_SNE_REG] = "9XY0",   [OP_LD_I] = "ANNN",     [OP_JP_V] = "BNNN",
+    [OP_RND] = "CXNN",       [OP_DRW] = "DXYN",       [OP_SKP] = "EX9E",      [OP_SKNP] = "EXA1",
+    [OP_LD_VX_DT] = "FX07",  [OP_LD_VX_K] = "FX0A",   [OP_LD_DT] = "FX15",    [OP_LD_ST] = "FX18",
+    [OP_ADD_I] = "FX1E",     [OP_LD_F] = "FX29",      [OP_LD_B] = "FX33",     [OP_LD_MEM] = "FX55",
+    [OP_LD_REGS] = "FX65",
+};
+
+const char* chip8_op_pattern(uint8_t op) {
+  return op < OP_COUNT ? op_patterns[op] : "????";
+}
+
+int chip8_disasm(const Chip8Insn* insn, char* buf, size_t len) {
+  uint8_t x = insn->x;
+  uint8_t y = insn->y;
+
+  switch (insn->op) {
+    case OP_SYS:
+      return snprintf(buf, len, "SYS 0x%03X", insn->nnn);
+    case OP_CLS:
+      return snprintf(buf, len, "CLS");
+    case OP_RET:
+      return snprintf(buf, len, "RET");
+    case OP_JP:
+      return snprintf(buf, len, "JP 0x%03X", insn->nnn);
+    case OP_CALL:
+      return snprintf(buf, len, "CALL 0x%03X", insn->nnn);
+    case OP_SE_IMM:
+      return snprintf(buf, len, "SE V%X, 0x%02X", x, insn->nn);
+    case OP_SNE_IMM:
+      return snprintf(buf, len, "SNE V%X, 0x%02X", x, insn->nn);
+    case OP_SE_REG:
+      return snprintf(buf, len, "SE V%X, V%X", x, y);
+    case OP_LD_IMM:
+      return snprintf(buf, len, "LD V%X, 0x%02X", x, insn->nn);
+    case OP_ADD_IMM:
+      return snprintf(buf, len, "ADD V%X, 0x%02X", x, insn->nn);
+    case OP_LD_REG:
+      return snprintf(buf, len, "LD V%X, V%X", x, y);
+    case OP_OR:
+      return snprintf(buf, len, "OR V%X, V%X", x, y);
+    case OP_AND:
+      return snprintf(buf, len, "AND V%X, V%X", x, y);
+    case OP_XOR:
+      return snprintf(buf, len, "XOR V%X, V%X", x, y);
+    case OP_ADD_REG:
+      return snprintf(buf, len, "ADD V%X, V%X", x, y);
+    case OP_SUB:
+      return snprintf(buf, len, "SUB V%X, V%X", x, y);
+    case OP_SHR:
+      return snprintf(buf, len, "SHR V%X", x);
+    case OP_SUBN:
+      return snprintf(buf, len, "SUBN V%X, V%X", x, y);
+    case OP_SHL:
+      return snprintf(buf, len, "SHL V%X", x);
+    case OP_SNE_REG:
+      return snprintf(buf, len, "SNE V%X, V%X", x, y);
+    case OP_LD_I:
+      return snprintf(buf, len, "LD I, 0x%03X", insn->nnn);
+    case OP_JP_V:
+      return snprintf(buf, len, "JP V%X, 0x%03X", x, insn->nnn);
+    case OP_RND:
+      return snprintf(buf, len, "RND V%X, 0x%02X", x, insn->nn);
+    case OP_DRW:
+      return snprintf(buf, len, "DRW V%X, V%X, %u", x, y, insn->n);
+    case OP_SKP:
+      return snprintf(buf, len, "SKP V%X", x);
+    case OP_SKNP:
+      return snprintf(buf, len, "SKNP V%X", x);
+    case OP_LD_VX_DT:
+      return snprintf(buf, len, "LD V%X, DT", x);
+    case OP_LD_VX_K:
+      return snprintf(buf, len, "LD V%X, K", x);
+    case OP_LD_DT:
+      return snprintf(buf, len, "LD DT, V%X", x);
+    case OP_LD_ST:
+      return snprintf(buf, len, "LD ST, V%X", x);
+    case OP_ADD_I:
+      return snprintf(buf, len, "ADD I, V%X", x);
+    case OP_LD_F:
+      return snprintf(buf, len, "LD F, V%X", x);
+    case OP_LD_B:
+      return snprintf(buf, len, "LD B, V%X", x);
+    case OP_LD_MEM:
+      return snprintf(buf, len, "LD [I], V%X", x);
+    case OP_LD_REGS:
+      return snprintf(buf, len, "LD V%X, [I]", x);
+    default:
+      return snprintf(buf, len, ".word 0x%04X", insn->opcode);
+  }
+}
@@ -6,25 +6,37 @@
 #include <stdlib.h>
 
 #include "chip8.h"
+#include "frontend.h"
 
 #define BLACK 0xFF000000
 #define WHITE 0xFFFFFFFF
+#define GRAY 0xFF303030
+// largest window the wall opens before it stops scaling up
+#define MAX_WINDOW_W 1600
 
 SDL_Window* display_window = NULL;
 SDL_Renderer* display_renderer = NULL;
 SDL_Texture* display_texture = NULL;
-static uint32_t pixels[SCREEN_SIZE];
-
-void display_init() {
-  // initialize sdl
-  if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
+static uint32_t* pixels = NULL;
+static int texture_w = SCREEN_W;
+static int texture_h = SCREEN_H;
+
+void display_init(int width, int height) {
+  texture_w = width;
+  texture_h = height;
+  int scale = MAX_WINDOW_W / width;
+  if (scale > 10) scale = 10;
+  if (scale < 1) scale = 1;
+
+  // initialize only video (and with it events); audio brings up its own
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     // fprintf(stderr, "SDL2 could not be initialize video subsystem: %s\n", SDL_GetError());
     exit(1);
   }
 
   // create window
   display_window = SDL_CreateWindow("Chip8 Emu", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                    SCREEN_W * 10, SCREEN_H * 10, SDL_WINDOW_RESIZABLE);
+                                    width * scale, height * scale, SDL_WINDOW_RESIZABLE);
 
   if (display_window == NULL) {
     // fprintf(stderr, "SDL_Window could not be created%s\n", SDL_GetError());
@@ -43,29 +55,34 @@ void display_init() {
   printf("Renderer used: %s\n", info.name);
 
   SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
-  SDL_RenderSetLogicalSize(display_renderer, SCREEN_W, SCREEN_H);
+  SDL_RenderSetLogicalSize(display_renderer, width, height);
   // create texture
   display_texture = SDL_CreateTexture(display_renderer,
                                       SDL_PIXELFORMAT_ARGB8888,
                                       SDL_TEXTUREACCESS_STREAMING,
-                                      SCREEN_W, SCREEN_H);
+                                      width, height);
 
   if (display_texture == NULL) {
     // fprintf(stderr, "SDL_Texture could not be created%s\n", SDL_GetError());
     exit(1);
   }
 
-  SDL_UpdateTexture(display_texture, NULL, pixels, SCREEN_W * sizeof(uint32_t));
+  pixels = malloc((size_t)width * height * sizeof(uint32_t));
+  if (pixels == NULL) {
+    exit(1);
+  }
+
   SDL_RenderClear(display_renderer);
-  SDL_RenderCopy(display_renderer, display_texture, NULL, NULL);
   SDL_RenderPresent(display_renderer);
 }
 
 void display_cleanup() {
-  SDL_DestroyWindow(display_window);
-  SDL_DestroyRenderer(display_renderer);
   SDL_DestroyTexture(display_texture);
+  SDL_DestroyRenderer(display_renderer);
+  SDL_DestroyWindow(display_window);
   SDL_Quit();
+  free(pixels);
+  pixels = NULL;
 }
 
 // Returns 0x0–0xF for valid CHIP-8 keys, or 0xFF if not mapped.
@@ -107,7 +124,7 @@ static uint8_t map_sdl_scancode(SDL_Scancode sc) {
       return 0xFF;
   }
 }
-static void update_keyboard_state() {
+static void update_keyboard_state(Chip8* chip) {
   const uint8_t* state = SDL_GetKeyboardState(NULL);
 
   // Check all 16 CHIP-8 keys
@@ -120,14 +137,14 @@ static void update_keyboard_state() {
   for (int i = 0; i < 16; i++) {
     uint8_t chip8_key = map_sdl_scancode(scancodes[i]);
     if (state[scancodes[i]]) {
-      chip8_key_down(chip8_key);
+      chip8_key_down(chip, chip8_key);
     } else {
-      chip8_key_up(chip8_key);
+      chip8_key_up(chip, chip8_key);
     }
   }
 }
 
-bool display_poll_events() {
+bool display_poll_events(Chip8* chip) {
   SDL_Event e;
   while (SDL_PollEvent(&e)) {
     if (e.type == SDL_QUIT) {
@@ -135,22 +152,20 @@ bool display_poll_events() {
     }
   }
 
-  update_keyboard_state();
+  if (chip != NULL) update_keyboard_state(chip);
   return false;
 }
 
-void display_render(const uint8_t* screen) {
-  for (unsigned y = 0; y < SCREEN_H; y++) {
-    for (unsigned x = 0; x < SCREEN_W; x++) {
-      uint8_t pixel = screen[SCREEN_IDX(y, x)];
+void display_present(const uint8_t* frame) {
+  static const uint32_t palette[4] = {[FRAME_OFF] = BLACK, [FRAME_ON] = WHITE, [FRAME_BORDER] = GRAY};
 
-      pixels[SCREEN_IDX(y, x)] = pixel ? WHITE : BLACK;
-    }
+  for (int i = 0; i < texture_w * texture_h; i++) {
+    pixels[i] = palette[frame[i] & 0x3];
   }
 
-  SDL_UpdateTexture(display_texture, NULL, pixels, SCREEN_W * sizeof(uint32_t));
+  SDL_UpdateTexture(display_texture, NULL, pixels, texture_w * sizeof(uint32_t));
 
   SDL_RenderClear(display_renderer);
   SDL_RenderCopy(display_renderer, display_texture, NULL, NULL);
   SDL_RenderPresent(display_renderer);
-}
\ No newline at end of file
+}
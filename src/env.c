@@ -0,0 +1,280 @@
+#define _POSIX_C_SOURCE 200809L  // strdup, ftruncate, shm_open
+
+#include "env.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framelog.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint64_t align_up(uint64_t n) {
+  return (n + CHIP8_ENV_ALIGN - 1) / CHIP8_ENV_ALIGN * CHIP8_ENV_ALIGN;
+}
+
+#ifndef _WIN32
+// NULL (with a message on stderr) if the segment can't be set up.
+static void* map_block(const char* shmName, uint64_t size) {
+  shm_unlink(shmName);  // a segment left behind by a crashed run
+  int fd = shm_open(shmName, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    perror(shmName);
+    return NULL;
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    perror("ftruncate");
+    close(fd);
+    shm_unlink(shmName);
+    return NULL;
+  }
+  void* block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (block == MAP_FAILED) {
+    perror("mmap");
+    shm_unlink(shmName);
+    return NULL;
+  }
+  return block;  // zero filled by ftruncate
+}
+#endif
+
+static uint8_t reward_value(const Chip8Env* env, int index) {
+  switch (env->reward_source) {
+    case CHIP8_REWARD_MEMORY:
+      return env->batch.machines[index].memory[env->reward_index];
+    case CHIP8_REWARD_REGISTER:
+      // registers live in the lane arrays only while the kernels run
+      return env->batch.vector ? env->batch.V[env->reward_index][index]
+                               : env->batch.machines[index].V[env->reward_index];
+    default:
+      return 0;
+  }
+}
+
+// A fault, or 1NNN jumping to its own address: nothing can move the lane
+// on from either.
+static bool halted(const Chip8Env* env, int index) {
+  if (env->batch.machines[index].fault != CHIP8_FAULT_NONE) return true;
+  uint16_t pc = env->batch.vector ? env->batch.PC[index] : env->batch.machines[index].PC;
+  if (pc >= MEM_SIZE - 1) return false;
+  const uint8_t* memory = env->batch.machines[index].memory;
+  return ((memory[pc] << 8) | memory[pc + 1]) == (0x1000 | pc);
+}
+
+// Fresh outputs for one environment after a reset.
+static void write_initial(Chip8Env* env, int index) {
+  Chip8* chip = &env->batch.machines[index];
+  framelog_pack(chip->screen, SCREEN_SIZE, &env->obs[(size_t)index * CHIP8_ENV_OBS_BYTES]);
+  chip->draw_flag = false;
+  env->reward[index] = 0.0f;
+  env->done[index] = 0;
+  env->reward_last[index] = reward_value(env, index);
+}
+
+// Seqlock writer side, see Chip8EnvHeader.steps. Only this process writes
+// steps, so a plain read of it is current.
+static void begin_write(Chip8Env* env) {
+  __atomic_store_n(&env->header->steps, env->header->steps + 1, __ATOMIC_RELAXED);
+  // odd before any output changes
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void end_write(Chip8Env* env) {
+  __atomic_store_n(&env->header->steps, env->header->steps + 1, __ATOMIC_RELEASE);
+}
+
+bool chip8_env_init(Chip8Env* env, int envs, const char* romPath, const char* shmName) {
+  memset(env, 0, sizeof(*env));
+  if (envs < 1) {
+    fprintf(stderr, "Need at least one environment\n");
+    return false;
+  }
+  if (!chip8_batch_init(&env->batch, envs, romPath, NULL)) return false;
+#ifdef _WIN32
+  if (shmName != NULL) {
+    fprintf(stderr, "No shared memory on Windows, keeping %s on the heap\n", shmName);
+    shmName = NULL;
+  }
+#endif
+
+  env->envs = envs;
+  env->insns_per_frame = CHIP8_ENV_INSNS_PER_FRAME;
+  env->reward_source = CHIP8_REWARD_NONE;
+  env->reward_index = 0;
+  env->reward_last = calloc(envs, 1);
+  env->shm_name = shmName != NULL ? strdup(shmName) : NULL;
+  if (env->reward_last == NULL || (shmName != NULL && env->shm_name == NULL)) {
+    fprintf(stderr, "Unable to allocate %d environments\n", envs);
+    chip8_env_free(env);
+    return false;
+  }
+
+  uint64_t obs_offset = align_up(sizeof(Chip8EnvHeader));
+  uint64_t reward_offset = align_up(obs_offset + (uint64_t)envs * CHIP8_ENV_OBS_BYTES);
+  uint64_t done_offset = align_up(reward_offset + (uint64_t)envs * sizeof(float));
+  uint64_t size = align_up(done_offset + envs);
+
+  uint8_t* block;
+#ifndef _WIN32
+  block = shmName != NULL ? map_block(shmName, size) : calloc(1, size);
+#else
+  block = calloc(1, size);
+#endif
+  if (block == NULL) {
+    if (shmName == NULL) fprintf(stderr, "Unable to allocate %d environments\n", envs);
+    chip8_env_free(env);
+    return false;
+  }
+
+  env->header = (Chip8EnvHeader*)block;
+  env->obs = block + obs_offset;
+  env->reward = (float*)(block + reward_offset);
+  env->done = block + done_offset;
+
+  Chip8EnvHeader* header = env->header;
+  header->version = CHIP8_ENV_VERSION;
+  header->envs = envs;
+  header->obs_bytes = CHIP8_ENV_OBS_BYTES;
+  header->obs_offset = obs_offset;
+  header->reward_offset = reward_offset;
+  header->done_offset = done_offset;
+  header->size = size;
+  header->steps = 0;
+  // magic last, so a reader never trusts a half written header
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(header->magic, CHIP8_ENV_MAGIC, 4);
+  return true;
+}
+
+bool chip8_env_set_reward(Chip8Env* env, Chip8RewardSource source, int index) {
+  if ((source == CHIP8_REWARD_MEMORY && (index < 0 || index >= MEM_SIZE)) ||
+      (source == CHIP8_REWARD_REGISTER && (index < 0 || index >= REG_SIZE))) {
+    fprintf(stderr, "Reward index out of range: %d\n", index);
+    return false;
+  }
+  env->reward_source = source;
+  env->reward_index = index;
+  for (int e = 0; e < env->envs; e++) {
+    env->reward_last[e] = reward_value(env, e);
+  }
+  return true;
+}
+
+bool chip8_env_reset(Chip8Env* env, const uint32_t* seeds) {
+  if (env->header == NULL) {
+    fprintf(stderr, "Environment not initialized\n");
+    return false;
+  }
+  begin_write(env);
+  for (int e = 0; e < env->envs; e++) {
+    chip8_batch_reset_lane(&env->batch, e, seeds ? seeds[e] : (uint32_t)e + 1);
+    write_initial(env, e);
+  }
+  end_write(env);
+  return true;
+}
+
+bool chip8_env_reset_one(Chip8Env* env, int index, uint32_t seed) {
+  if (index < 0 || index >= env->envs) {
+    fprintf(stderr, "No environment %d\n", index);
+    return false;
+  }
+  begin_write(env);
+  chip8_batch_reset_lane(&env->batch, index, seed);
+  write_initial(env, index);
+  end_write(env);
+  return true;
+}
+
+void chip8_env_step(Chip8Env* env, const uint8_t* actions, int frames) {
+  for (int e = 0; e < env->envs; e++) {
+    bool* keys = env->batch.machines[e].keys;
+    memset(keys, 0, KEY_SIZE * sizeof(bool));
+    if (actions[e] < KEY_SIZE) keys[actions[e]] = true;
+  }
+
+  for (int f = 0; f < frames; f++) {
+    chip8_batch_run_frame(&env->batch, env->insns_per_frame);
+  }
+
+  begin_write(env);
+  for (int e = 0; e < env->envs; e++) {
+    Chip8* chip = &env->batch.machines[e];
+    // only lanes that drew since the last step need repacking
+    if (chip->draw_flag) {
+      framelog_pack(chip->screen, SCREEN_SIZE, &env->obs[(size_t)e * CHIP8_ENV_OBS_BYTES]);
+      chip->draw_flag = false;
+    }
+
+    uint8_t value = reward_value(env, e);
+    env->reward[e] = (float)value - (float)env->reward_last[e];
+    env->reward_last[e] = value;
+
+    if (!env->done[e] && halted(env, e)) env->done[e] = 1;
+  }
+  end_write(env);
+}
+
+void chip8_env_free(Chip8Env* env) {
+  if (env->shm_name != NULL) {
+#ifndef _WIN32
+    if (env->header != NULL) {
+      munmap(env->header, env->header->size);
+      shm_unlink(env->shm_name);
+    }
+#endif
+    free(env->shm_name);
+  } else {
+    free(env->header);
+  }
+  free(env->reward_last);
+  chip8_batch_free(&env->batch);
+  memset(env, 0, sizeof(*env));
+}
+
+const Chip8EnvHeader* chip8_env_attach(const char* shmName) {
+#ifndef _WIN32
+  int fd = shm_open(shmName, O_RDONLY, 0);
+  if (fd < 0) {
+    perror(shmName);
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Chip8EnvHeader)) {
+    fprintf(stderr, "%s is not an environment block\n", shmName);
+    close(fd);
+    return NULL;
+  }
+  const Chip8EnvHeader* header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (header == MAP_FAILED) {
+    perror("mmap");
+    return NULL;
+  }
+  if (memcmp(header->magic, CHIP8_ENV_MAGIC, 4) != 0 || header->version != CHIP8_ENV_VERSION ||
+      header->size != (uint64_t)st.st_size) {
+    fprintf(stderr, "%s is not an environment block\n", shmName);
+    munmap((void*)header, st.st_size);
+    return NULL;
+  }
+  return header;
+#else
+  fprintf(stderr, "Shared memory environments are not supported on Windows (%s)\n", shmName);
+  return NULL;
+#endif
+}
+
+void chip8_env_detach(const Chip8EnvHeader* header) {
+#ifndef _WIN32
+  munmap((void*)header, header->size);
+#else
+  (void)header;
+#endif
+}
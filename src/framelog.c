@@ -0,0 +1,256 @@
+#include "framelog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frontend.h"
+
+#define HEADER_SIZE 9
+#define RECORD_HEADER_SIZE 13
+
+static void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static void put_u64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+  return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--) v = v << 8 | p[i];
+  return v;
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+  return v;
+}
+
+void framelog_pack(const uint8_t* frame, size_t pixels, uint8_t* bits) {
+  // Eight pixels per multiply: FRAME_ON is the only value with bit 0 set,
+  // and the magic moves bit 0 of byte i to bit 63 - i (little endian).
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    uint64_t word;
+    memcpy(&word, &frame[i], sizeof(word));
+    bits[i >> 3] = (uint8_t)(((word & 0x0101010101010101ull) * 0x8040201008040201ull) >> 56);
+  }
+  if (i < pixels) bits[i >> 3] = 0;
+  for (; i < pixels; i++) {
+    if (frame[i] == FRAME_ON) bits[i >> 3] |= 0x80 >> (i & 7);
+  }
+}
+
+void framelog_unpack(const uint8_t* bits, size_t pixels, uint8_t* frame) {
+  for (size_t i = 0; i < pixels; i++) {
+    frame[i] = (bits[i >> 3] >> (7 - (i & 7))) & 1 ? FRAME_ON : FRAME_OFF;
+  }
+}
+
+size_t framelog_encode(const uint8_t* cur, const uint8_t* prev, size_t n, uint8_t* out) {
+  size_t len = 0;
+  size_t pos = 0;
+
+#define DIFF(i) (prev ? cur[i] ^ prev[i] : cur[i])
+  while (pos < n) {
+    uint8_t zeros = 0;
+    while (pos < n && zeros < 255 && DIFF(pos) == 0) {
+      zeros++;
+      pos++;
+    }
+    // an unchanged tail needs no triplet at all
+    if (pos == n) break;
+
+    size_t count_at = len + 1;
+    uint8_t literals = 0;
+    out[len++] = zeros;
+    len++;
+    while (pos < n && literals < 255 && DIFF(pos) != 0) {
+      out[len++] = DIFF(pos);
+      literals++;
+      pos++;
+    }
+    out[count_at] = literals;
+  }
+#undef DIFF
+
+  return len;
+}
+
+bool framelog_decode(const uint8_t* in, size_t len, uint8_t* bits, size_t n) {
+  size_t pos = 0;
+  size_t i = 0;
+
+  while (i < len) {
+    if (i + 2 > len) return false;
+    size_t zeros = in[i++];
+    size_t literals = in[i++];
+    if (i + literals > len || pos + zeros + literals > n) return false;
+
+    pos += zeros;
+    for (size_t k = 0; k < literals; k++) {
+      bits[pos++] ^= in[i++];
+    }
+  }
+  return true;
+}
+
+bool framelog_write_header(FILE* f, uint16_t width, uint16_t height) {
+  uint8_t header[HEADER_SIZE];
+  memcpy(header, FRAMELOG_MAGIC, 4);
+  header[4] = FRAMELOG_VERSION;
+  put_u16(&header[5], width);
+  put_u16(&header[7], height);
+  return fwrite(header, 1, sizeof(header), f) == sizeof(header);
+}
+
+bool framelog_write_record(FILE* f, uint8_t type, uint64_t usec, const uint8_t* payload, uint32_t len) {
+  uint8_t header[RECORD_HEADER_SIZE];
+  header[0] = type;
+  put_u64(&header[1], usec);
+  put_u32(&header[9], len);
+  return fwrite(header, 1, sizeof(header), f) == sizeof(header) &&
+         fwrite(payload, 1, len, f) == len;
+}
+
+bool framelog_open(FramelogReader* reader, const char* path) {
+  memset(reader, 0, sizeof(*reader));
+
+  reader->file = fopen(path, "rb");
+  if (reader->file == NULL) {
+    fprintf(stderr, "Unable to open frame log: %s\n", path);
+    return false;
+  }
+
+  uint8_t header[HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+      memcmp(header, FRAMELOG_MAGIC, 4) != 0 || header[4] != FRAMELOG_VERSION) {
+    fprintf(stderr, "Not a frame log: %s\n", path);
+    framelog_close(reader);
+    return false;
+  }
+  reader->width = get_u16(&header[5]);
+  reader->height = get_u16(&header[7]);
+  reader->frame_bytes = framelog_frame_bytes(reader->width, reader->height);
+
+  fseek(reader->file, 0, SEEK_END);
+  long file_end = ftell(reader->file);
+  fseek(reader->file, HEADER_SIZE, SEEK_SET);
+
+  // index pass: read record headers only, skipping payloads
+  size_t capacity = 0;
+  long offset = HEADER_SIZE;
+  uint8_t record[RECORD_HEADER_SIZE];
+  while (fread(record, 1, sizeof(record), reader->file) == sizeof(record)) {
+    uint32_t len = get_u32(&record[9]);
+    long next = offset + RECORD_HEADER_SIZE + (long)len;
+    // a truncated final record is what a crashed recorder leaves behind
+    if (next > file_end || len > framelog_max_encoded(reader->frame_bytes)) break;
+
+    if (reader->count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      long* offsets = realloc(reader->offsets, capacity * sizeof(long));
+      uint64_t* timestamps = realloc(reader->timestamps, capacity * sizeof(uint64_t));
+      uint8_t* types = realloc(reader->types, capacity);
+      if (offsets) reader->offsets = offsets;
+      if (timestamps) reader->timestamps = timestamps;
+      if (types) reader->types = types;
+      if (!offsets || !timestamps || !types) {
+        fprintf(stderr, "Unable to allocate frame log index\n");
+        exit(1);
+      }
+    }
+    reader->offsets[reader->count] = offset;
+    reader->timestamps[reader->count] = get_u64(&record[1]);
+    reader->types[reader->count] = record[0];
+    reader->count++;
+
+    offset = next;
+    fseek(reader->file, offset, SEEK_SET);
+  }
+
+  reader->bits = calloc(reader->frame_bytes, 1);
+  reader->payload = malloc(framelog_max_encoded(reader->frame_bytes));
+  if (reader->bits == NULL || reader->payload == NULL) {
+    fprintf(stderr, "Unable to allocate frame log buffers\n");
+    exit(1);
+  }
+  reader->position = reader->count;
+  return true;
+}
+
+static bool apply_record(FramelogReader* reader, size_t index) {
+  uint8_t record[RECORD_HEADER_SIZE];
+  fseek(reader->file, reader->offsets[index], SEEK_SET);
+  if (fread(record, 1, sizeof(record), reader->file) != sizeof(record)) return false;
+
+  uint32_t len = get_u32(&record[9]);
+  if (fread(reader->payload, 1, len, reader->file) != len) return false;
+
+  if (record[0] == FRAMELOG_KEYFRAME) {
+    memset(reader->bits, 0, reader->frame_bytes);
+  }
+  return framelog_decode(reader->payload, len, reader->bits, reader->frame_bytes);
+}
+
+bool framelog_seek(FramelogReader* reader, size_t index) {
+  if (index >= reader->count) return false;
+  if (index == reader->position) return true;
+
+  size_t key = index;
+  while (key > 0 && reader->types[key] != FRAMELOG_KEYFRAME) key--;
+
+  // keep decoding forward when no keyframe lies between here and there
+  size_t from = key;
+  if (reader->position < reader->count && reader->position < index && reader->position >= key) {
+    from = reader->position + 1;
+  } else if (reader->types[key] != FRAMELOG_KEYFRAME) {
+    // no keyframe at all before index; deltas start from a blank frame
+    memset(reader->bits, 0, reader->frame_bytes);
+  }
+
+  for (size_t i = from; i <= index; i++) {
+    if (!apply_record(reader, i)) {
+      reader->position = reader->count;
+      return false;
+    }
+  }
+  reader->position = index;
+  return true;
+}
+
+size_t framelog_find(const FramelogReader* reader, uint64_t usec) {
+  size_t lo = 0;
+  size_t hi = reader->count;
+  // first frame with a timestamp > usec
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (reader->timestamps[mid] <= usec) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 ? lo - 1 : 0;
+}
+
+void framelog_close(FramelogReader* reader) {
+  if (reader->file) fclose(reader->file);
+  free(reader->offsets);
+  free(reader->timestamps);
+  free(reader->types);
+  free(reader->bits);
+  free(reader->payload);
+  memset(reader, 0, sizeof(*reader));
+}
@@ -0,0 +1,62 @@
+#include "frontend.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "audio.h"
+#include "display.h"
+
+// --- SDL: window + audio device ---
+
+static void sdl_init(int width, int height) {
+  display_init(width, height);
+  audio_init();
+}
+
+static void sdl_beep(bool on) {
+  if (on) {
+    audio_beep_on();
+  } else {
+    audio_beep_off();
+  }
+}
+
+static void sdl_cleanup() {
+  audio_cleanup();
+  display_cleanup();
+}
+
+const Frontend frontend_sdl = {
+    "sdl", sdl_init, display_present, display_poll_events, sdl_beep, sdl_cleanup,
+};
+
+// --- null: no output, no input; for benchmarks and headless runs ---
+
+static void null_init(int width, int height) {
+  (void)width;
+  (void)height;
+}
+
+static void null_present(const uint8_t* frame) { (void)frame; }
+
+static bool null_poll(Chip8* chip) {
+  (void)chip;
+  return false;
+}
+
+static void null_beep(bool on) { (void)on; }
+
+static void null_cleanup() {}
+
+const Frontend frontend_null = {
+    "null", null_init, null_present, null_poll, null_beep, null_cleanup,
+};
+
+static const Frontend* frontends[] = {&frontend_sdl, &frontend_term, &frontend_null};
+
+const Frontend* frontend_find(const char* name) {
+  for (size_t i = 0; i < sizeof(frontends) / sizeof(frontends[0]); i++) {
+    if (strcmp(frontends[i]->name, name) == 0) return frontends[i];
+  }
+  return NULL;
+}
@@ -1,14 +1,17 @@
 // src/main.c
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <sys/time.h>
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 
-#include "audio.h"
 #include "chip8.h"
-#include "display.h"
+#include "frontend.h"
+#include "recorder.h"
+#include "wall.h"
 
 // Timing configuration
 #define CPU_HZ 1200
@@ -19,16 +22,67 @@ static int64_t timediff_usec(const struct timeval* prev, const struct timeval* c
          ((int64_t)curr->tv_usec - (int64_t)prev->tv_usec);
 }
 
+static Chip8 machine;
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [--frontend sdl|term|null] [--vip] [--record file] <path/to/rom>\n", prog);
+  fprintf(stderr, "       %s --wall [-j threads] [--frontend ...] [--vip] [--record file] <path/to/rom>...\n",
+          prog);
+}
+
 int main(int argc, char** argv) {
-  if (argc != 2) {
-    fprintf(stderr, "Usage: %s <path/to/rom>\n", argv[0]);
+  bool vip_timing = false;
+  bool wall = false;
+  int threads = 1;
+  const Frontend* frontend = &frontend_sdl;
+  const char* record_path = NULL;
+  int first_rom = argc;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--vip") == 0) {
+      vip_timing = true;
+    } else if (strcmp(argv[i], "--wall") == 0) {
+      wall = true;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--frontend") == 0 && i + 1 < argc) {
+      frontend = frontend_find(argv[++i]);
+      if (frontend == NULL) {
+        fprintf(stderr, "Unknown frontend: %s\n", argv[i]);
+        return 42;
+      }
+    } else {
+      first_rom = i;
+      break;
+    }
+  }
+
+  int roms = argc - first_rom;
+  if (roms == 0 || (!wall && roms != 1)) {
+    usage(argv[0]);
     return 42;
   }
 
-  chip8_init();
-  display_init();
-  audio_init();
-  chip8_load_rom(argv[1]);
+  int width = SCREEN_W;
+  int height = SCREEN_H;
+  if (wall) {
+    wall_init(&argv[first_rom], roms, threads, CPU_HZ / TIMER_HZ, vip_timing);
+    wall_size(&width, &height);
+    frontend->init(width, height);
+  } else {
+    chip8_init(&machine);
+    if (!chip8_load_rom(&machine, argv[first_rom])) {
+      return 42;
+    }
+    frontend->init(SCREEN_W, SCREEN_H);
+  }
+
+  if (record_path != NULL && !recorder_start(record_path, width, height)) {
+    frontend->cleanup();
+    return 42;
+  }
 
   const int64_t cpu_step = 1000000LL / CPU_HZ;
   const int64_t timer_step = 1000000LL / TIMER_HZ;
@@ -38,10 +92,13 @@ int main(int argc, char** argv) {
 
   struct timeval last;
   gettimeofday(&last, NULL);
+  const struct timeval start = last;
 
   bool quit = false;
+  bool beeping = false;
+  int exit_code = 0;
   while (!quit) {
-    if (display_poll_events())
+    if (frontend->poll(wall ? NULL : &machine))
       quit = true;
 
     struct timeval now;
@@ -56,32 +113,75 @@ int main(int argc, char** argv) {
     cpu_acc += dt;
     timer_acc += dt;
 
-    // --- CPU EXECUTION (multiple steps if needed) ---
-    int steps = 0;
-    const int MAX_STEPS = 1000;
+    if (wall) {
+      // --- WALL: every machine runs whole frames, one upload for all ---
+      while (timer_acc >= timer_step) {
+        wall_run_frame();
+        timer_acc -= timer_step;
+      }
+      const uint8_t* frame = wall_take_frame();
+      if (frame != NULL) {
+        frontend->present(frame);
+        recorder_capture(frame, timediff_usec(&start, &now));
+      }
+
+      SDL_Delay(1);
+      continue;
+    }
+
+    if (vip_timing) {
+      // --- VIP TIMING: whole frames, timers driven by emulated cycles ---
+      while (timer_acc >= timer_step) {
+        chip8_run_frame_vip(&machine);
+        timer_acc -= timer_step;
+      }
+    } else {
+      // --- CPU EXECUTION (multiple steps if needed) ---
+      int steps = 0;
+      const int MAX_STEPS = 1000;
+
+      while (cpu_acc >= cpu_step && steps < MAX_STEPS) {
+        // superinstructions retire several opcodes per call
+        int retired = chip8_execute(&machine);
+        cpu_acc -= cpu_step * retired;
+        steps += retired;
+      }
+
+      // --- 60Hz Timers ---
+      while (timer_acc >= timer_step) {
+        chip8_tick(&machine);
+        timer_acc -= timer_step;
+      }
+    }
 
-    while (cpu_acc >= cpu_step && steps < MAX_STEPS) {
-      chip8_execute();
-      cpu_acc -= cpu_step;
-      steps++;
+    if (machine.fault != CHIP8_FAULT_NONE) {
+      fprintf(stderr, "%s at 0x%03X\n", chip8_fault_name(machine.fault), machine.PC);
+      exit_code = 1;
+      quit = true;
     }
 
-    // --- 60Hz Timers ---
-    while (timer_acc >= timer_step) {
-      chip8_tick();
-      timer_acc -= timer_step;
+    // --- BEEP WHILE THE SOUND TIMER RUNS ---
+    if (chip8_sound_on(&machine) != beeping) {
+      beeping = !beeping;
+      frontend->beep(beeping);
     }
 
     // --- DRAW IF FLAGGED ---
-    if (chip8_can_draw()) {
-      display_render(chip8_get_screen());
-      chip8_set_draw_false();
+    if (chip8_can_draw(&machine)) {
+      frontend->present(chip8_get_screen(&machine));
+      recorder_capture(chip8_get_screen(&machine), timediff_usec(&start, &now));
+      chip8_set_draw_false(&machine);
     }
 
     SDL_Delay(1);
   }
 
-  display_cleanup();
-  audio_cleanup();
-  return 0;
+  recorder_stop();
+  if (wall) {
+    wall_cleanup();
+  } else {
+    chip8_free(&machine);
+  }
+  frontend->cleanup();
+  return exit_code;
 }
@@ -0,0 +1,163 @@
+#include "recorder.h"
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framelog.h"
+
+// Must be a power of two; about four seconds of frames at 60 fps.
+#define QUEUE_SLOTS 256
+#define WRITER_IDLE_MS 4
+
+// Single producer (the emulation loop), single consumer (the writer).
+// Each side only stores its own index, so no locks are needed.
+typedef struct {
+  uint64_t usec;
+  uint8_t* bits;
+} RecorderSlot;
+
+static RecorderSlot slots[QUEUE_SLOTS];
+static atomic_uint head;  // next slot the producer fills
+static atomic_uint tail;  // next slot the writer drains
+static atomic_bool stopping;
+static atomic_bool failed;  // a write failed; the writer has given up
+
+static FILE* file = NULL;
+static SDL_Thread* writer = NULL;
+static size_t pixels = 0;
+static size_t frame_bytes = 0;
+static uint8_t* previous = NULL;  // last frame written
+static uint8_t* encoded = NULL;
+static unsigned written = 0;
+static unsigned dropped = 0;
+
+static bool write_frame(const RecorderSlot* slot) {
+  bool key = written % FRAMELOG_KEYFRAME_INTERVAL == 0;
+  size_t len = framelog_encode(slot->bits, key ? NULL : previous, frame_bytes, encoded);
+
+  if (!framelog_write_record(file, key ? FRAMELOG_KEYFRAME : FRAMELOG_DELTA, slot->usec, encoded,
+                             (uint32_t)len)) {
+    return false;
+  }
+  // keyframes mark a point a reader can start from, so get them on disk
+  if (key && fflush(file) != 0) return false;
+
+  memcpy(previous, slot->bits, frame_bytes);
+  written++;
+  return true;
+}
+
+static int writer_main(void* data) {
+  (void)data;
+
+  for (;;) {
+    // read stopping first so a frame queued just before it is not missed
+    bool last_pass = atomic_load_explicit(&stopping, memory_order_acquire);
+    unsigned h = atomic_load_explicit(&head, memory_order_acquire);
+    unsigned t = atomic_load_explicit(&tail, memory_order_relaxed);
+
+    while (t != h) {
+      if (!write_frame(&slots[t % QUEUE_SLOTS])) {
+        // capture sees this and stops queueing; recorder_stop() reports it
+        atomic_store_explicit(&failed, true, memory_order_release);
+        return 1;
+      }
+      t++;
+      atomic_store_explicit(&tail, t, memory_order_release);
+    }
+
+    if (last_pass) break;
+    SDL_Delay(WRITER_IDLE_MS);
+  }
+  return 0;
+}
+
+// Closes the file and frees the buffers; returns false if the close failed.
+static bool release(void) {
+  bool closed = fclose(file) == 0;
+  file = NULL;
+
+  free(slots[0].bits);
+  free(previous);
+  free(encoded);
+  slots[0].bits = NULL;
+  previous = NULL;
+  encoded = NULL;
+  return closed;
+}
+
+bool recorder_start(const char* path, int width, int height) {
+  file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to open recording file: %s\n", path);
+    return false;
+  }
+
+  pixels = (size_t)width * height;
+  frame_bytes = framelog_frame_bytes(width, height);
+  previous = calloc(frame_bytes, 1);
+  encoded = malloc(framelog_max_encoded(frame_bytes));
+  slots[0].bits = malloc(frame_bytes * QUEUE_SLOTS);
+  if (previous == NULL || encoded == NULL || slots[0].bits == NULL) {
+    fprintf(stderr, "Unable to allocate recorder buffers\n");
+    release();
+    return false;
+  }
+  for (int i = 1; i < QUEUE_SLOTS; i++) {
+    slots[i].bits = &slots[0].bits[i * frame_bytes];
+  }
+
+  written = 0;
+  dropped = 0;
+  atomic_init(&head, 0);
+  atomic_init(&tail, 0);
+  atomic_init(&stopping, false);
+  atomic_init(&failed, false);
+
+  if (!framelog_write_header(file, (uint16_t)width, (uint16_t)height)) {
+    fprintf(stderr, "Unable to write frame log: %s\n", path);
+    release();
+    return false;
+  }
+
+  writer = SDL_CreateThread(writer_main, "recorder", NULL);
+  if (writer == NULL) {
+    fprintf(stderr, "Unable to start recorder thread: %s\n", SDL_GetError());
+    release();
+    return false;
+  }
+  return true;
+}
+
+void recorder_capture(const uint8_t* frame, uint64_t usec) {
+  if (writer == NULL || atomic_load_explicit(&failed, memory_order_relaxed)) return;
+
+  unsigned h = atomic_load_explicit(&head, memory_order_relaxed);
+  unsigned t = atomic_load_explicit(&tail, memory_order_acquire);
+  if (h - t == QUEUE_SLOTS) {
+    dropped++;
+    return;
+  }
+
+  RecorderSlot* slot = &slots[h % QUEUE_SLOTS];
+  slot->usec = usec;
+  framelog_pack(frame, pixels, slot->bits);
+  atomic_store_explicit(&head, h + 1, memory_order_release);
+}
+
+void recorder_stop() {
+  if (writer == NULL) return;
+
+  atomic_store_explicit(&stopping, true, memory_order_release);
+  SDL_WaitThread(writer, NULL);
+  writer = NULL;
+
+  if (!release() || atomic_load_explicit(&failed, memory_order_acquire)) {
+    fprintf(stderr, "Unable to write frame log, recording stopped after %u frames\n", written);
+  } else if (dropped > 0) {
+    fprintf(stderr, "Recorder dropped %u of %u frames\n", dropped, dropped + written);
+  }
+}
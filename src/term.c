@@ -0,0 +1,212 @@
+// ANSI terminal frontend: two CHIP-8 rows per text row using half blocks,
+// and only the cells that changed since the last frame are written.
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifndef _WIN32
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#include "chip8.h"
+#include "frontend.h"
+
+// Terminals report key presses but not releases, so a press holds the
+// CHIP-8 key down for this long.
+#define KEY_HOLD_USEC 150000
+#define CELL_UNKNOWN 0xFF
+
+// UTF-8 glyph for each (top | bottom << 1) cell value
+static const char* glyphs[4] = {
+    " ",
+    "\xE2\x96\x80",  // U+2580 upper half block
+    "\xE2\x96\x84",  // U+2584 lower half block
+    "\xE2\x96\x88",  // U+2588 full block
+};
+
+static int frame_w = 0;
+static int frame_h = 0;
+static int rows = 0;
+static uint8_t* cells = NULL;  // glyph index currently shown in each cell
+static char* out = NULL;
+static volatile sig_atomic_t interrupted = 0;
+static int64_t key_release[KEY_SIZE];  // usec timestamps
+
+#ifndef _WIN32
+static struct termios saved_termios;
+#endif
+
+static int64_t now_usec() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void on_interrupt(int sig) {
+  (void)sig;
+  interrupted = 1;
+}
+
+static void term_init(int width, int height) {
+  frame_w = width;
+  frame_h = height;
+  rows = (height + 1) / 2;
+
+  cells = malloc((size_t)width * rows);
+  // worst case per cell: a cursor move plus a 3 byte glyph
+  out = malloc((size_t)width * rows * 16 + 64);
+  if (cells == NULL || out == NULL) {
+    fprintf(stderr, "Unable to allocate terminal buffers\n");
+    exit(1);
+  }
+  memset(cells, CELL_UNKNOWN, (size_t)width * rows);
+  memset(key_release, 0, sizeof(key_release));
+
+#ifndef _WIN32
+  struct termios raw;
+  tcgetattr(STDIN_FILENO, &saved_termios);
+  raw = saved_termios;
+  raw.c_lflag &= ~(ICANON | ECHO);
+  // read() returns at once with whatever is pending. O_NONBLOCK would do
+  // the same but is shared with stdout on a tty, where writes could then
+  // fail with EAGAIN and leave cells[] out of step with the screen.
+  raw.c_cc[VMIN] = 0;
+  raw.c_cc[VTIME] = 0;
+  tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+#endif
+  signal(SIGINT, on_interrupt);
+
+  // alternate screen, hide cursor, clear
+  fputs("\x1b[?1049h\x1b[?25l\x1b[2J", stdout);
+  fflush(stdout);
+}
+
+static void term_present(const uint8_t* frame) {
+  size_t n = 0;
+  int cursor_row = -1;
+  int cursor_col = -1;
+
+  for (int r = 0; r < rows; r++) {
+    const uint8_t* top = &frame[(2 * r) * frame_w];
+    const uint8_t* bottom = 2 * r + 1 < frame_h ? top + frame_w : NULL;
+
+    for (int x = 0; x < frame_w; x++) {
+      uint8_t cell = (top[x] == FRAME_ON) | (bottom && bottom[x] == FRAME_ON) << 1;
+      if (cells[r * frame_w + x] == cell) continue;
+      cells[r * frame_w + x] = cell;
+
+      if (r != cursor_row || x != cursor_col) {
+        n += sprintf(&out[n], "\x1b[%d;%dH", r + 1, x + 1);
+      }
+      size_t len = strlen(glyphs[cell]);
+      memcpy(&out[n], glyphs[cell], len);
+      n += len;
+      cursor_row = r;
+      cursor_col = x + 1;
+    }
+  }
+
+  if (n > 0) {
+    fwrite(out, 1, n, stdout);
+    fflush(stdout);
+  }
+}
+
+// Same layout as the SDL keyboard map; 0xFF if not mapped.
+static uint8_t map_char(char ch) {
+  switch (ch) {
+    case '1':
+      return 0x1;
+    case '2':
+      return 0x2;
+    case '3':
+      return 0x3;
+    case '4':
+      return 0xC;
+    case 'q':
+      return 0x4;
+    case 'w':
+      return 0x5;
+    case 'e':
+      return 0x6;
+    case 'r':
+      return 0xD;
+    case 'a':
+      return 0x7;
+    case 's':
+      return 0x8;
+    case 'd':
+      return 0x9;
+    case 'f':
+      return 0xE;
+    case 'z':
+      return 0xA;
+    case 'x':
+      return 0x0;
+    case 'c':
+      return 0xB;
+    case 'v':
+      return 0xF;
+    default:
+      return 0xFF;
+  }
+}
+
+static bool term_poll(Chip8* chip) {
+  if (interrupted) return true;
+
+  int64_t now = now_usec();
+#ifndef _WIN32
+  char buf[64];
+  ssize_t len;
+  while ((len = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+    // a lone ESC quits; escape sequences (arrows etc.) are ignored
+    if (len == 1 && buf[0] == 0x1b) return true;
+
+    for (ssize_t i = 0; i < len; i++) {
+      uint8_t key = map_char(buf[i]);
+      if (key != 0xFF) key_release[key] = now + KEY_HOLD_USEC;
+    }
+  }
+#endif
+
+  if (chip != NULL) {
+    for (uint8_t k = 0; k < KEY_SIZE; k++) {
+      if (key_release[k] > now) {
+        chip8_key_down(chip, k);
+      } else {
+        chip8_key_up(chip, k);
+      }
+    }
+  }
+  return false;
+}
+
+static void term_beep(bool on) {
+  if (on) {
+    fputc('\a', stdout);
+    fflush(stdout);
+  }
+}
+
+static void term_cleanup() {
+  fputs("\x1b[0m\x1b[?25h\x1b[?1049l", stdout);
+  fflush(stdout);
+
+#ifndef _WIN32
+  tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+#endif
+  signal(SIGINT, SIG_DFL);
+
+  free(cells);
+  free(out);
+  cells = NULL;
+  out = NULL;
+}
+
+const Frontend frontend_term = {
+    "term", term_init, term_present, term_poll, term_beep, term_cleanup,
+};
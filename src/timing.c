@@ -0,0 +1,37 @@
+#include "timing.h"
+
+// Averages of the original interpreter's routines, in machine cycles.
+static const uint16_t base_cycles[OP_COUNT] = {
+    [OP_UNKNOWN] = 10,  [OP_SYS] = 23,      [OP_CLS] = 24,      [OP_RET] = 23,
+    [OP_JP] = 23,       [OP_CALL] = 26,     [OP_SE_IMM] = 12,   [OP_SNE_IMM] = 12,
+    [OP_SE_REG] = 16,   [OP_LD_IMM] = 6,    [OP_ADD_IMM] = 10,  [OP_LD_REG] = 44,
+    [OP_OR] = 44,       [OP_AND] = 44,      [OP_XOR] = 44,      [OP_ADD_REG] = 44,
+    [OP_SUB] = 44,      [OP_SHR] = 44,      [OP_SUBN] = 44,     [OP_SHL] = 44,
+    [OP_SNE_REG] = 16,  [OP_LD_I] = 12,     [OP_JP_V] = 23,     [OP_RND] = 36,
+    [OP_DRW] = 26,      [OP_SKP] = 16,      [OP_SKNP] = 16,     [OP_LD_VX_DT] = 10,
+    [OP_LD_VX_K] = 10,  [OP_LD_DT] = 10,    [OP_LD_ST] = 10,    [OP_ADD_I] = 19,
+    [OP_LD_F] = 20,     [OP_LD_B] = 204,    [OP_LD_MEM] = 14,   [OP_LD_REGS] = 14,
+};
+
+uint16_t chip8_vip_cycles(const Chip8Insn* insn, uint8_t vx) {
+  uint16_t cycles = insn->op < OP_COUNT ? base_cycles[insn->op] : 10;
+
+  switch (insn->op) {
+    case OP_DRW: {
+      // byte-aligned rows are copied, others are shifted into place bit by bit
+      unsigned shift = vx % 8;
+      unsigned per_row = shift ? 22 + 3 * shift : 12;
+      cycles += per_row * insn->n;
+      break;
+    }
+    case OP_LD_MEM:
+    case OP_LD_REGS:
+      // one load/store loop iteration per register
+      cycles += 14 * (insn->x + 1);
+      break;
+    default:
+      break;
+  }
+
+  return cycles;
+}
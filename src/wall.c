@@ -0,0 +1,200 @@
+#include "wall.h"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "frontend.h"
+
+#define GUTTER 1
+#define TILE_W (SCREEN_W + GUTTER)
+#define TILE_H (SCREEN_H + GUTTER)
+
+// A contiguous range of machines stepped by one thread.
+typedef struct {
+  int first;
+  int last;  // one past the end
+  bool dirty;
+  SDL_Thread* thread;
+  SDL_sem* start;
+  SDL_sem* done;
+} WallSlice;
+
+static Chip8* machines = NULL;
+static char** rom_paths = NULL;
+static int machine_count = 0;
+static int cols = 0;
+static uint8_t* atlas = NULL;  // FRAME_* bytes
+static int atlas_w = 0;
+static int atlas_h = 0;
+static WallSlice* slices = NULL;
+static int slice_count = 0;
+static int frame_insns = 0;
+static bool frame_vip = false;
+static bool stopping = false;
+
+// Copies a machine's framebuffer into its tile of the atlas.
+static void blit_tile(int index, const uint8_t* screen) {
+  uint8_t* tile = &atlas[(index / cols) * TILE_H * atlas_w + (index % cols) * TILE_W];
+  for (int y = 0; y < SCREEN_H; y++) {
+    memcpy(&tile[y * atlas_w], &screen[SCREEN_IDX(y, 0)], SCREEN_W);
+  }
+}
+
+// Tints the unlit pixels of a tile whose machine faulted; it stays frozen.
+static void mark_tile(int index) {
+  uint8_t* tile = &atlas[(index / cols) * TILE_H * atlas_w + (index % cols) * TILE_W];
+  for (int y = 0; y < SCREEN_H; y++) {
+    for (int x = 0; x < SCREEN_W; x++) {
+      if (tile[y * atlas_w + x] == FRAME_OFF) tile[y * atlas_w + x] = FRAME_BORDER;
+    }
+  }
+}
+
+static void step_slice(WallSlice* slice) {
+  for (int i = slice->first; i < slice->last; i++) {
+    Chip8* chip = &machines[i];
+    if (chip->fault != CHIP8_FAULT_NONE) continue;
+
+    if (frame_vip) {
+      chip8_run_frame_vip(chip);
+    } else {
+      for (int n = 0; n < frame_insns;) {
+        n += chip8_execute(chip);
+      }
+      chip8_tick(chip);
+    }
+
+    if (chip8_can_draw(chip)) {
+      blit_tile(i, chip8_get_screen(chip));
+      chip8_set_draw_false(chip);
+      slice->dirty = true;
+    }
+
+    // only this machine stops; the rest of the wall keeps running
+    if (chip->fault != CHIP8_FAULT_NONE) {
+      fprintf(stderr, "%s: %s at 0x%03X, stopped\n", rom_paths[i], chip8_fault_name(chip->fault), chip->PC);
+      mark_tile(i);
+      slice->dirty = true;
+    }
+  }
+}
+
+static int slice_worker(void* data) {
+  WallSlice* slice = data;
+
+  for (;;) {
+    SDL_SemWait(slice->start);
+    if (stopping) break;
+    step_slice(slice);
+    SDL_SemPost(slice->done);
+  }
+  return 0;
+}
+
+void wall_init(char** roms, int count, int threads, int insns_per_frame, bool vip_timing) {
+  machine_count = count;
+  rom_paths = roms;
+  frame_insns = insns_per_frame;
+  frame_vip = vip_timing;
+
+  machines = calloc(count, sizeof(Chip8));
+  if (machines == NULL) {
+    fprintf(stderr, "Unable to allocate %d machines\n", count);
+    exit(1);
+  }
+  for (int i = 0; i < count; i++) {
+    chip8_init(&machines[i]);
+    if (!chip8_load_rom(&machines[i], roms[i])) {
+      exit(42);
+    }
+  }
+
+  // tiles are 2:1, so a square-ish grid gives a 2:1 window
+  cols = (int)ceil(sqrt((double)count));
+  int rows = (count + cols - 1) / cols;
+  atlas_w = cols * TILE_W - GUTTER;
+  atlas_h = rows * TILE_H - GUTTER;
+
+  atlas = malloc((size_t)atlas_w * atlas_h);
+  if (atlas == NULL) {
+    fprintf(stderr, "Unable to allocate %dx%d atlas\n", atlas_w, atlas_h);
+    exit(1);
+  }
+  memset(atlas, FRAME_BORDER, (size_t)atlas_w * atlas_h);
+  for (int i = 0; i < count; i++) {
+    blit_tile(i, chip8_get_screen(&machines[i]));
+  }
+
+  if (threads < 1) threads = 1;
+  if (threads > count) threads = count;
+  slice_count = threads;
+  slices = calloc(slice_count, sizeof(WallSlice));
+  for (int t = 0; t < slice_count; t++) {
+    WallSlice* slice = &slices[t];
+    slice->first = count * t / slice_count;
+    slice->last = count * (t + 1) / slice_count;
+    slice->dirty = true;
+
+    // slice 0 runs on the calling thread
+    if (t == 0) continue;
+    slice->start = SDL_CreateSemaphore(0);
+    slice->done = SDL_CreateSemaphore(0);
+    slice->thread = SDL_CreateThread(slice_worker, "wall", slice);
+    if (slice->thread == NULL) {
+      fprintf(stderr, "Unable to start wall thread: %s\n", SDL_GetError());
+      exit(1);
+    }
+  }
+}
+
+void wall_run_frame() {
+  for (int t = 1; t < slice_count; t++) {
+    SDL_SemPost(slices[t].start);
+  }
+  step_slice(&slices[0]);
+  for (int t = 1; t < slice_count; t++) {
+    SDL_SemWait(slices[t].done);
+  }
+}
+
+void wall_size(int* width, int* height) {
+  *width = atlas_w;
+  *height = atlas_h;
+}
+
+const uint8_t* wall_take_frame() {
+  bool dirty = false;
+  for (int t = 0; t < slice_count; t++) {
+    dirty |= slices[t].dirty;
+    slices[t].dirty = false;
+  }
+
+  return dirty ? atlas : NULL;
+}
+
+void wall_cleanup() {
+  stopping = true;
+  for (int t = 1; t < slice_count; t++) {
+    SDL_SemPost(slices[t].start);
+    SDL_WaitThread(slices[t].thread, NULL);
+    SDL_DestroySemaphore(slices[t].start);
+    SDL_DestroySemaphore(slices[t].done);
+  }
+
+  free(slices);
+  free(atlas);
+  for (int i = 0; i < machine_count; i++) {
+    chip8_free(&machines[i]);
+  }
+  free(machines);
+  slices = NULL;
+  atlas = NULL;
+  machines = NULL;
+  rom_paths = NULL;
+  slice_count = 0;
+  machine_count = 0;
+}